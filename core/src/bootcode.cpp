@@ -74,6 +74,65 @@ void BootCode_Default_Handler(void)
 	}
 }
 
+// LZ4 block format decompressor for the images packed by the tools/lz4pack.py
+// the loops must not be replaced with memcpy() calls, the library is not loaded yet
+
+__attribute__ ((section(".bootcode_code"),used,optimize("no-tree-loop-distribute-patterns")))
+void _bootcode_lz4_decompress(const uint8_t * src, uint8_t * dst, uint8_t * dstend)
+{
+	while (dst < dstend)
+	{
+		unsigned token = *src++;
+
+		// literals
+		unsigned len = (token >> 4);
+		if (15 == len)
+		{
+			unsigned b;
+			do
+			{
+				b = *src++;
+				len += b;
+			}
+			while (255 == b);
+		}
+
+		while (len)
+		{
+			*dst++ = *src++;
+			--len;
+		}
+
+		if (dst >= dstend)
+		{
+			break;  // the last sequence has only literals
+		}
+
+		// match
+		const uint8_t * mp = dst - (src[0] | (src[1] << 8));
+		src += 2;
+
+		len = (token & 15);
+		if (15 == len)
+		{
+			unsigned b;
+			do
+			{
+				b = *src++;
+				len += b;
+			}
+			while (255 == b);
+		}
+		len += 4;
+
+		while (len)  // might overlap, byte by byte
+		{
+			*dst++ = *mp++;
+			--len;
+		}
+	}
+}
+
 // these are defined in the linker script
 extern unsigned __ramcode_regions_array_start;
 extern unsigned __ramcode_regions_array_end;
@@ -94,7 +153,7 @@ void _bootcode_start() // cold boot entry point
 	unsigned * destaddr;
 	unsigned * destaddrend;
 
-	// 1. Copy the main code regions to the RAM
+	// 1. Copy (or decompress) the main code regions to the RAM
 
 	recp = 	(unsigned *)&__ramcode_regions_array_start;
 	while (recp < &__ramcode_regions_array_end)
@@ -106,6 +165,12 @@ void _bootcode_start() // cold boot entry point
 		destaddrend = (unsigned *)(*recp);
 		++recp;
 
+		if (unsigned(loadaddr) & 1)  // LZ4 compressed image (marked by the lz4pack.py)
+		{
+			_bootcode_lz4_decompress((const uint8_t *)(unsigned(loadaddr) & ~1), (uint8_t *)destaddr, (uint8_t *)destaddrend);
+			continue;
+		}
+
 	  // It is assumed that the pointers are word aligned.
 	  while (destaddr < destaddrend)
 	  {
@@ -54,6 +54,94 @@ void clockcnt_init()
 
 #endif
 
+#if defined(CLOCKCNT16) && (__CORTEX_M < 3)
+  #define CLOCKCNT64_HW    CLOCKCNT16  // extend directly the hardware counter
+  #define CLOCKCNT64_WRAP  0x10000
+#else
+  #define CLOCKCNT64_HW    CLOCKCNT
+  #define CLOCKCNT64_WRAP  0x100000000ull
+#endif
+
+static uint64_t  clockcnt64_base = 0;
+static uint32_t  clockcnt64_last = 0;
+
+uint64_t clockcnt64()
+{
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	uint32_t t = CLOCKCNT64_HW;
+	if (t < clockcnt64_last)
+	{
+		clockcnt64_base += CLOCKCNT64_WRAP;
+	}
+	clockcnt64_last = t;
+	uint64_t result = clockcnt64_base + t;
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+
+	return result;
+}
+
+static uint64_t  clockcnt64_us_base = 0;  // microseconds at the clockcnt64_us_ref
+static uint64_t  clockcnt64_us_ref = 0;   // clockcnt64() at the last CPU speed change
+
+uint64_t clockcnt64_us()
+{
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	uint64_t result = clockcnt64_us_base + (clockcnt64() - clockcnt64_us_ref) / (SystemCoreClock / 1000000);
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+
+	return result;
+}
+
+void clockcnt64_rebase_us()
+{
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	// fold the elapsed clocks with the current speed, the remainder continues with the new one
+	unsigned clocks_per_us = SystemCoreClock / 1000000;
+	uint64_t now = clockcnt64();
+	uint64_t elapsed = now - clockcnt64_us_ref;
+	clockcnt64_us_base += elapsed / clocks_per_us;
+	clockcnt64_us_ref = now - (elapsed % clocks_per_us);
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+}
+
+void clockcnt64_init()
+{
+#if CLOCKCNT64_SYSTICK_HANDLER
+	// tick at the half wrap period, but the SysTick has only 24 bits
+	uint64_t period = CLOCKCNT64_WRAP / 2;
+	if (period > 0x01000000)  period = 0x01000000;
+
+	SysTick->CTRL = 0;
+	SysTick->LOAD = unsigned(period) - 1;
+	SysTick->VAL  = 0;
+	SysTick->CTRL = (SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk);
+#endif
+
+	clockcnt64();
+}
+
+#if CLOCKCNT64_SYSTICK_HANDLER
+
+#if defined(PCPROF_SYSTICK_HANDLER) && PCPROF_SYSTICK_HANDLER
+  #error "The CLOCKCNT64_SYSTICK_HANDLER and PCPROF_SYSTICK_HANDLER can not be used together"
+#endif
+
+extern "C" void SysTick_Handler()
+{
+	clockcnt64();
+}
+
+#endif
+
 void delay_clocks(unsigned aclocks)
 {
 	unsigned remaining = aclocks;
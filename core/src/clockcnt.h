@@ -40,6 +40,7 @@
   // from Cortex-M3 use the DWT_CYCCNT:
   #define CLOCKCNT (*((volatile unsigned *)0xE0001004))
   #define CLOCKCNT_BITS  32
+  #define CLOCKCNT_WRITABLE  // can be corrected after the deep sleep modes
 
 #elif defined(CLOCKCNT16)
 
@@ -79,6 +80,26 @@ void clockcnt_init();  // for Cortex-M0 it is platform dependent
 
 void delay_clocks(unsigned aclocks);
 
+// 64 bit clock counter, wrap-safe and callable from interrupt context too.
+// The extension must see every hardware counter wrap, so it must be called at least once per wrap period
+// (~7 s at 600 MHz with the DWT, 0.68 ms at 96 MHz with CLOCKCNT16). With CLOCKCNT64_SYSTICK_HANDLER = 1
+// the clockcnt64_init() starts the SysTick for this (at the half wrap period, the SysTick_Handler is defined
+// in the clockcnt.cpp then), so only the interrupt disabled sections must stay shorter than the half wrap period.
+// Otherwise the clockcnt64() must be called from a periodic IRQ (e.g. timer overflow) or often enough from
+// the main loop (the TTimerWheel::Run() calls it too).
+
+#ifndef CLOCKCNT64_SYSTICK_HANDLER
+  #define CLOCKCNT64_SYSTICK_HANDLER  0
+#endif
+
+void     clockcnt64_init();  // call after the clockcnt_init()
+uint64_t clockcnt64();
+
+// microseconds from the clockcnt64(), continuous over the CPU speed changes: the clockcnt64_rebase_us()
+// must be called before the SystemCoreClock changes (the THwClkCtrl::ChangeCpuSpeed() does it)
+uint64_t clockcnt64_us();
+void     clockcnt64_rebase_us();
+
 inline void delay_us(unsigned aus)
 {
 	delay_clocks(aus * (SystemCoreClock / 1000000));
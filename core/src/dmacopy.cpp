@@ -0,0 +1,279 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     dmacopy.cpp
+ *  brief:    Asynchronous memory copy / fill service with a memory to memory DMA channel
+ *  version:  1.00
+ *  date:     2021-08-12
+ *  authors:  nvitya
+*/
+
+#include "string.h"
+#include "dmacopy.h"
+
+bool TDmaCopyManager::Init(THwDmaChannel * adma)
+{
+	initialized = false;
+
+	dma = adma;
+	if (!dma || !dma->initialized)
+	{
+		return false;
+	}
+
+	dma->cache_maint = true;
+	dma->cache_align_check = false;  // arbitrary buffers are allowed here, see the notes in the header
+
+	firstreq = nullptr;
+	lastreq = nullptr;
+	curreq = nullptr;
+	firstdone = nullptr;
+	lastdone = nullptr;
+	in_callbacks = false;
+
+	initialized = true;
+	return true;
+}
+
+bool TDmaCopyManager::AddCopy(TDmaCopyReq * areq, void * adst, const void * asrc, unsigned alen)
+{
+	areq->dstaddr = adst;
+	areq->srcaddr = asrc;
+	areq->length = alen;
+	areq->isfill = false;
+
+	return AddRequest(areq);
+}
+
+bool TDmaCopyManager::AddFill(TDmaCopyReq * areq, void * adst, uint8_t avalue, unsigned alen)
+{
+	areq->dstaddr = adst;
+	areq->srcaddr = nullptr;
+	areq->length = alen;
+	areq->isfill = true;
+	areq->fillvalue = avalue;
+
+	return AddRequest(areq);
+}
+
+bool TDmaCopyManager::AddRequest(TDmaCopyReq * areq)
+{
+	if (!initialized)
+	{
+		areq->errorcode = ERROR_NOTINIT;
+		areq->completed = true;
+		return false;
+	}
+
+	areq->errorcode = 0;
+	areq->next = nullptr;
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	bool idle = (!curreq && !firstreq);
+	if (idle && (areq->length < cpu_threshold))
+	{
+		__set_PRIMASK(pm); // restore interrupt disable status
+
+		// short ones are faster with the CPU
+		ExecCpu(areq);
+		return true;
+	}
+
+	areq->completed = false;
+	if (lastreq)
+	{
+		lastreq->next = areq;
+	}
+	else
+	{
+		firstreq = areq;
+	}
+	lastreq = areq;
+
+	if (!curreq)
+	{
+		StartNextReq();
+	}
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+
+	RunCallbacks();  // zero length requests are finished immediately
+
+	return true;
+}
+
+void TDmaCopyManager::WaitRequest(TDmaCopyReq * areq)
+{
+	while (!areq->completed)
+	{
+		Run();
+	}
+}
+
+void TDmaCopyManager::ExecCpu(TDmaCopyReq * areq)
+{
+	if (areq->isfill)
+	{
+		memset(areq->dstaddr, areq->fillvalue, areq->length);
+	}
+	else
+	{
+		memcpy(areq->dstaddr, areq->srcaddr, areq->length);
+	}
+
+	areq->errorcode = 0;
+	areq->completed = true;
+	if (areq->callback)
+	{
+		(* (areq->callback))(areq->callbackarg);
+	}
+}
+
+void TDmaCopyManager::StartNextReq()  // called with disabled interrupts
+{
+	while (firstreq)
+	{
+		curreq = firstreq;
+		firstreq = firstreq->next;
+		if (!firstreq)
+		{
+			lastreq = nullptr;
+		}
+
+		if (0 == curreq->length)
+		{
+			FinishCurReq(0);
+			continue;
+		}
+
+		// select the widest possible transfer unit
+
+		unsigned alignbits = (unsigned(curreq->dstaddr) | curreq->length);
+		if (!curreq->isfill)
+		{
+			alignbits |= unsigned(curreq->srcaddr);
+		}
+
+		if (0 == (alignbits & 3))       xfer.bytewidth = 4;
+		else if (0 == (alignbits & 1))  xfer.bytewidth = 2;
+		else                            xfer.bytewidth = 1;
+
+		xfer.dstaddr = curreq->dstaddr;
+		xfer.count = curreq->length / xfer.bytewidth;
+		xfer.flags = DMATR_MEM_TO_MEM | (irq_mode ? DMATR_IRQ : 0);
+
+		if (curreq->isfill)
+		{
+			fillword = curreq->fillvalue * 0x01010101;
+			xfer.srcaddr = &fillword;
+			xfer.flags |= DMATR_NO_SRC_INC;
+		}
+		else
+		{
+			xfer.srcaddr = (void *)curreq->srcaddr;
+		}
+
+		dma->StartTransfer(&xfer);  // does the D-Cache maintenance, longer than HW_DMA_MAX_COUNT are chained
+		return;
+	}
+}
+
+void TDmaCopyManager::FinishCurReq(int aerror)  // called with disabled interrupts
+{
+	TDmaCopyReq * req = curreq;
+	curreq = nullptr;
+
+	// the callback is called later by the RunCallbacks(), with the restored interrupt state
+	req->errorcode = aerror;
+	req->next = nullptr;
+	if (lastdone)
+	{
+		lastdone->next = req;
+	}
+	else
+	{
+		firstdone = req;
+	}
+	lastdone = req;
+}
+
+void TDmaCopyManager::RunCallbacks()
+{
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	if (in_callbacks)  // called from a callback: the running loop reports the new ones too
+	{
+		__set_PRIMASK(pm); // restore interrupt disable status
+		return;
+	}
+
+	in_callbacks = true;
+
+	while (firstdone)
+	{
+		TDmaCopyReq * req = firstdone;
+		firstdone = req->next;
+		if (!firstdone)
+		{
+			lastdone = nullptr;
+		}
+
+		__set_PRIMASK(pm); // restore interrupt disable status
+
+		// the callback might add the same request object again
+		req->completed = true;
+		if (req->callback)
+		{
+			(* (req->callback))(req->callbackarg);
+		}
+
+		__disable_irq();
+	}
+
+	in_callbacks = false;
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+}
+
+void TDmaCopyManager::Run()
+{
+	if (curreq && !dma->Active())  // starts the next chunk of the long transfers too
+	{
+		unsigned pm = __get_PRIMASK();  // save interrupt disable status
+		__disable_irq();
+
+		if (curreq && !dma->Active())  // the Active() invalidates the destination at the end
+		{
+			FinishCurReq(0);
+			StartNextReq();
+		}
+
+		__set_PRIMASK(pm); // restore interrupt disable status
+	}
+
+	if (firstdone)
+	{
+		RunCallbacks();
+	}
+}
@@ -0,0 +1,107 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     dmacopy.h
+ *  brief:    Asynchronous memory copy / fill service with a memory to memory DMA channel
+ *  version:  1.00
+ *  date:     2021-08-12
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    The requests are executed in order. Requests shorter than cpu_threshold are done immediately
+ *    with the CPU (memcpy / memset) when the queue is empty.
+ *    The D-Cache is maintained for the source and destination ranges (Cortex-M7), but the destination
+ *    should be cache line aligned, otherwise the neighboring data in the first and last lines
+ *    must not be written by the CPU during the transfer.
+ *    The Run() must be called periodically or from the DMA IRQ (irq_mode).
+ *    The callbacks are called with the original interrupt state, and never nested: the requests
+ *    finished during a callback (or in an IRQ meanwhile) are reported after it returned.
+*/
+
+#ifndef DMACOPY_H_
+#define DMACOPY_H_
+
+#include "platform.h"
+#include "hwdma.h"
+#include "errors.h"
+
+typedef void (* PDmaCopyCbFunc)(void * arg);
+
+class TDmaCopyReq
+{
+public:
+	void *             dstaddr = nullptr;
+	const void *       srcaddr = nullptr;  // not used for fill
+	unsigned           length = 0;         // in bytes
+
+	bool               isfill = false;
+	uint8_t            fillvalue = 0;
+
+	volatile bool      completed = true;
+	int                errorcode = 0;
+
+	PDmaCopyCbFunc     callback = nullptr;
+	void *             callbackarg = nullptr;
+
+	TDmaCopyReq *      next = nullptr;
+};
+
+class TDmaCopyManager
+{
+public: // settings
+	unsigned           cpu_threshold = 128;  // shorter requests are done with the CPU
+	bool               irq_mode = false;     // sets DMATR_IRQ on the transfers, the Run() must be called from the DMA IRQ
+
+public:
+	THwDmaChannel *    dma = nullptr;
+	bool               initialized = false;
+
+	bool               Init(THwDmaChannel * adma);  // the channel must be initialized already (memory to memory capable)
+
+	bool               AddCopy(TDmaCopyReq * areq, void * adst, const void * asrc, unsigned alen);
+	bool               AddFill(TDmaCopyReq * areq, void * adst, uint8_t avalue, unsigned alen);
+	bool               AddRequest(TDmaCopyReq * areq);
+
+	void               WaitRequest(TDmaCopyReq * areq); // blocking
+	inline bool        Idle() { return (!curreq && !firstreq && !firstdone); }
+
+	void               Run();
+
+protected:
+	TDmaCopyReq *      firstreq = nullptr;
+	TDmaCopyReq *      lastreq = nullptr;
+	TDmaCopyReq *      curreq = nullptr;
+
+	// finished requests waiting for the callback
+	TDmaCopyReq *      firstdone = nullptr;
+	TDmaCopyReq *      lastdone = nullptr;
+	bool               in_callbacks = false;
+
+	THwDmaTransfer     xfer;
+	uint32_t           fillword = 0;
+
+	void               StartNextReq();
+	void               FinishCurReq(int aerror);
+	void               RunCallbacks();
+	void               ExecCpu(TDmaCopyReq * areq);
+};
+
+#endif /* DMACOPY_H_ */
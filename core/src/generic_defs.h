@@ -35,6 +35,23 @@
 
 #define ALWAYS_INLINE  inline __attribute__((always_inline))
 
+// Placement into the faster memories (the linker scripts copy these at startup, where the memory is not present
+// the region is aliased to the RAM). Larger lists can be generated with the tools/hotplace.py.
+
+#define CODE_ITCRAM    __attribute__((section(".text_ITCRAM"), noinline))
+#define CODE_DTCRAM    __attribute__((section(".text_DTCRAM"), noinline))
+#define CODE_RAM2      __attribute__((section(".text_RAM2"), noinline))
+
+#define DATA_ITCRAM    __attribute__((section(".data_ITCRAM")))
+#define DATA_DTCRAM    __attribute__((section(".data_DTCRAM")))
+#define DATA_RAM2      __attribute__((section(".data_RAM2")))
+
+#define BSS_DTCRAM     __attribute__((section(".bss_DTCRAM")))
+#define BSS_RAM2       __attribute__((section(".bss_RAM2")))
+
+#define NOINIT_DTCRAM  __attribute__((section(".noinit_DTCRAM")))
+#define NOINIT_RAM2    __attribute__((section(".noinit_RAM2")))
+
 #if defined(DEBUG)
   #define __DEBUG_BKPT()  asm volatile ("bkpt 0")
 #else
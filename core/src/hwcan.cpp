@@ -222,3 +222,12 @@ void THwCan::StartSendMessage(uint16_t cobid, void * srcptr, unsigned len)
 
 	StartSendMessage(&msg);
 }
+
+void THwCan::ClockChanged()
+{
+	if (initialized)
+	{
+		SetSpeed(speed);
+		canbitcpuclocks = SystemCoreClock / speed;
+	}
+}
@@ -154,6 +154,8 @@ class THwCan : public HWCAN_IMPL
 public:
 	bool  Init(int adevnum, TCanMsg * arxbuf, uint16_t arxcnt, TCanMsg * atxbuf, uint16_t atxcnt);
 
+	void  ClockChanged();  // recalculates the bit timing after a CPU speed change
+
 	bool  TryRecvMessage(TCanMsg * msg);
 
 	void  StartSendMessage(TCanMsg * msg);
@@ -29,11 +29,22 @@
  *    The MCU usually starts with a slower internal oscillator. The THwClkCtrl class
  *    allows to set up the maximal speed. The vendor dependent implementations usually restrict
  *    the selectable clock speeds
+ *
+ *    The ChangeCpuSpeed() / SelectProfile() changes the CPU speed at runtime. The peripheral drivers
+ *    calculate their clock dividers at the initialization, so they must be registered for re-timing:
+ *
+ *      hwclkctrl.AddChangeNotify(&uartnotify, hwclkctrl_notify_obj<THwUart>, &conuart, hwclkctrl_busy_obj<THwUart>);
+ *
+ *    The change waits until the registered busy functions report idle (transfer or DMA finished),
+ *    and fails when they remain busy. So it must be called with enabled interrupts, when the transfers
+ *    are driven by IRQ. The delay_us() and the clockcnt64_us() follow the change, but the already
+ *    calculated CLOCKCNT deadlines are not corrected.
 */
 
 #include "platform.h"
 
 #include "hwclkctrl.h"
+#include "clockcnt.h"
 
 THwClkCtrl  hwclkctrl;
 
@@ -62,6 +73,7 @@ bool THwClkCtrl::InitCpuClock(unsigned abasespeed, unsigned acpuspeed)
   	return false;
   }
 
+  SetRestoreInfo(true, abasespeed, acpuspeed);
   SetClockInfo(acpuspeed); // early initialization might require the clock speed but this will cleared at cpp init
   return true;
 }
@@ -89,6 +101,7 @@ bool THwClkCtrl::InitCpuClockIntRC(unsigned abasespeed, unsigned acpuspeed)
   	return false;
   }
 
+  SetRestoreInfo(false, abasespeed, acpuspeed);
   SetClockInfo(acpuspeed); // early initialization might require the clock speed but this will cleared at cpp init
   return true;
 }
@@ -98,3 +111,137 @@ void THwClkCtrl::SetClockInfo(unsigned acpuspeed)
 	SystemCoreClock = acpuspeed;  // update the standard CMSIS variable as well
 }
 
+
+void THwClkCtrl::SetRestoreInfo(bool aextosc, unsigned abasespeed, unsigned acpuspeed)
+{
+	saved_extosc = aextosc;
+	saved_basespeed = abasespeed;
+	saved_cpuspeed = acpuspeed;
+}
+
+bool THwClkCtrl::RestoreCpuClock()
+{
+	if (!saved_cpuspeed)
+	{
+		return false;
+	}
+
+	if (saved_extosc)
+	{
+		return InitCpuClock(saved_basespeed, saved_cpuspeed);
+	}
+	else
+	{
+		return InitCpuClockIntRC(saved_basespeed, saved_cpuspeed);
+	}
+}
+
+int THwClkCtrl::AddProfile(unsigned acpuspeed)
+{
+	if (profile_count >= HWCLKCTRL_MAX_PROFILES)
+	{
+		return -1;
+	}
+
+	profile_speed[profile_count] = acpuspeed;
+	++profile_count;
+	return profile_count - 1;
+}
+
+bool THwClkCtrl::SelectProfile(int aprofile)
+{
+	if ((aprofile < 0) || (aprofile >= int(profile_count)))
+	{
+		return false;
+	}
+
+	if (!ChangeCpuSpeed(profile_speed[aprofile]))
+	{
+		return false;
+	}
+
+	profile_current = aprofile;
+	return true;
+}
+
+bool THwClkCtrl::ChangeCpuSpeed(unsigned acpuspeed)
+{
+	if (!saved_cpuspeed)
+	{
+		return false;  // the base clock setup is not known
+	}
+
+	if (acpuspeed == SystemCoreClock)
+	{
+		return true;
+	}
+
+	// wait until the re-timed peripherals finish their transfers, then keep the interrupts disabled
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	clockcnt_t t0 = CLOCKCNT;
+	unsigned waitclocks = change_busy_wait_us * (SystemCoreClock / 1000000);
+	while (true)
+	{
+		__disable_irq();
+		if (!NotifyBusy())
+		{
+			break;
+		}
+
+	 	__set_PRIMASK(pm); // restore interrupt disable status
+
+		if (ELAPSEDCLOCKS(CLOCKCNT, t0) > waitclocks)
+		{
+			return false;
+		}
+	}
+
+	clockcnt64_rebase_us();  // with the old speed
+
+	// the Flash wait states must fit to the higher speed during the change
+	PrepareHiSpeed(acpuspeed > SystemCoreClock ? acpuspeed : SystemCoreClock);
+
+	bool result = SetupPlls(saved_extosc, saved_basespeed, acpuspeed);
+	if (result)
+	{
+		PrepareHiSpeed(acpuspeed);
+		SetRestoreInfo(saved_extosc, saved_basespeed, acpuspeed);
+		SetClockInfo(acpuspeed);
+
+		// the drivers recalculate their dividers before any interrupt could use them
+		TClkChangeNotify * pnotify = firstnotify;
+		while (pnotify)
+		{
+			(*pnotify->func)(pnotify->arg);
+			pnotify = pnotify->next;
+		}
+	}
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+
+	return result;
+}
+
+bool THwClkCtrl::NotifyBusy()
+{
+	TClkChangeNotify * pnotify = firstnotify;
+	while (pnotify)
+	{
+		if (pnotify->busyfunc && (*pnotify->busyfunc)(pnotify->arg))
+		{
+			return true;
+		}
+		pnotify = pnotify->next;
+	}
+	return false;
+}
+
+void THwClkCtrl::AddChangeNotify(TClkChangeNotify * anotify, PClkChangeFunc afunc, void * aarg, PClkBusyFunc abusyfunc)
+{
+	anotify->func = afunc;
+	anotify->busyfunc = abusyfunc;
+	anotify->arg = aarg;
+	anotify->next = firstnotify;
+	firstnotify = anotify;
+}
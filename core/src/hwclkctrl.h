@@ -29,6 +29,22 @@
 #ifndef HWCLKCTRL_H_PRE_
 #define HWCLKCTRL_H_PRE_
 
+#ifndef HWCLKCTRL_MAX_PROFILES
+  #define HWCLKCTRL_MAX_PROFILES  4
+#endif
+
+typedef void (* PClkChangeFunc)(void * arg);
+typedef bool (* PClkBusyFunc)(void * arg);  // true = transfer in progress, the speed can not be changed now
+
+class TClkChangeNotify
+{
+public:
+	PClkChangeFunc      func = nullptr;
+	PClkBusyFunc        busyfunc = nullptr;  // optional
+	void *              arg = nullptr;
+	TClkChangeNotify *  next = nullptr;
+};
+
 class THwClkCtrl_pre
 {
 };
@@ -80,10 +96,59 @@ public:
 
    // Required to call when the oscillator setup was done before the cppinit
 	void SetClockInfo(unsigned acpuspeed);
+
+public: // clock restore after deep sleep modes, which stop the oscillators / PLLs
+	bool     saved_extosc = false;
+	unsigned saved_basespeed = 0;
+	unsigned saved_cpuspeed = 0;  // 0 = nothing to restore
+
+	// The InitCpuClock...() calls store their parameters, but the cppinit clears them,
+	// so when the clock setup was done before the cppinit this must be called too
+	void SetRestoreInfo(bool aextosc, unsigned abasespeed, unsigned acpuspeed);
+
+	// Sets up the last clock configuration again
+	bool RestoreCpuClock();
+
+public: // runtime CPU speed change (dynamic clock scaling)
+	unsigned           profile_speed[HWCLKCTRL_MAX_PROFILES] = {};
+	unsigned           profile_count = 0;
+	int                profile_current = -1;
+
+	TClkChangeNotify * firstnotify = nullptr;
+	unsigned           change_busy_wait_us = 1000;  // max. wait for the busy peripherals
+
+	int  AddProfile(unsigned acpuspeed);  // returns the profile index, -1 = no more space
+	bool SelectProfile(int aprofile);
+
+	// Sets the CPU speed using the same base clock as the last InitCpuClock...() and notifies
+	// the registered objects with disabled interrupts. Returns false when a registered object
+	// remained busy for change_busy_wait_us.
+	bool ChangeCpuSpeed(unsigned acpuspeed);
+
+	void AddChangeNotify(TClkChangeNotify * anotify, PClkChangeFunc afunc, void * aarg, PClkBusyFunc abusyfunc = nullptr);
+
+protected:
+	bool NotifyBusy();
 };
 
 extern THwClkCtrl  hwclkctrl;
 
+// helper for the objects with ClockChanged() (THwUart, THwSpi, THwI2c, THwCan, THwSdcard, TTimerWheel)
+
+template <class T>
+void hwclkctrl_notify_obj(void * aobj)
+{
+	((T *)aobj)->ClockChanged();
+}
+
+// helper for the objects with ClockChangeBusy() (THwUart, THwSpi, THwI2c)
+
+template <class T>
+bool hwclkctrl_busy_obj(void * aobj)
+{
+	return ((T *)aobj)->ClockChangeBusy();
+}
+
 #endif // ndef HWCLKCTRL_H_
 
 #else
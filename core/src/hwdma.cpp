@@ -28,5 +28,205 @@
 
 #include <hwdma.h>
 
+void THwDmaChannel::StartTransfer(THwDmaTransfer * axfer)
+{
+	curchainitem = nullptr;
+	StartItem(axfer);
+}
 
+void THwDmaChannel::StartChain(THwDmaTransfer * afirst)
+{
+	curchainitem = nullptr;
 
+#if defined(HWDMA_NATIVE_CHAIN)
+	chainremaining = 0;
+	if (PrepareChain(afirst))
+	{
+		THwDmaTransfer * xfer = afirst;
+		while (xfer)
+		{
+			CachePrepare(xfer);
+			xfer = xfer->next;
+			if (xfer == afirst)  break;
+		}
+		cacheinvlen = 0;
+		cacheinvchain = afirst;
+
+		StartPreparedTransfer();
+		return;
+	}
+#endif
+
+	// software chain
+	curchainitem = afirst;
+	StartItem(afirst);
+}
+
+void THwDmaChannel::StartItem(THwDmaTransfer * axfer)
+{
+	CachePrepare(axfer);
+
+	if ((axfer->count <= HW_DMA_MAX_COUNT) || (axfer->flags & DMATR_CIRCULAR))
+	{
+		chainremaining = 0;
+		PrepareTransfer(axfer);
+		StartPreparedTransfer();
+		return;
+	}
+
+	chainxfer = *axfer;
+	chainremaining = axfer->count;
+	StartNextChunk();
+}
+
+void THwDmaChannel::StartNextChunk()
+{
+	unsigned cnt = chainremaining;
+	if (cnt > HW_DMA_MAX_COUNT)  cnt = HW_DMA_MAX_COUNT;
+
+	chainxfer.count = cnt;
+	PrepareTransfer(&chainxfer);
+	chainremaining -= cnt;
+	StartPreparedTransfer();
+
+	unsigned bytecnt = cnt * chainxfer.bytewidth;
+	if (0 == (chainxfer.flags & DMATR_NO_SRC_INC))
+	{
+		chainxfer.srcaddr = (uint8_t *)chainxfer.srcaddr + bytecnt;
+	}
+	if (0 == (chainxfer.flags & DMATR_NO_DST_INC))
+	{
+		chainxfer.dstaddr = (uint8_t *)chainxfer.dstaddr + bytecnt;
+	}
+}
+
+bool THwDmaChannel::Active()
+{
+	if (HWDMACHANNEL_IMPL::Active())
+	{
+		return true;
+	}
+
+	if ((0 == chainremaining) && !(curchainitem && curchainitem->next))
+	{
+		curchainitem = nullptr;
+		CacheFinish();
+		return false;
+	}
+
+	// start the next chunk or chain item, the Active() might be called from IRQ context too
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	if (!HWDMACHANNEL_IMPL::Active())
+	{
+		if (chainremaining)
+		{
+			StartNextChunk();
+		}
+		else if (curchainitem && curchainitem->next)
+		{
+			CacheFinish();
+			curchainitem = curchainitem->next;
+			StartItem(curchainitem);
+		}
+	}
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+
+	return true;
+}
+
+void THwDmaChannel::CachePrepare(THwDmaTransfer * axfer)
+{
+	cacheinvlen = 0;
+	cacheinvchain = nullptr;
+
+#if __DCACHE_PRESENT
+
+	if (!cache_maint || (0 == (SCB->CCR & SCB_CCR_DC_Msk)))
+	{
+		return;
+	}
+
+	bool memsrc = (istx || (axfer->flags & DMATR_MEM_TO_MEM));
+	bool memdst = (!istx || (axfer->flags & DMATR_MEM_TO_MEM));
+
+	if (memsrc)
+	{
+		unsigned len = axfer->bytewidth * ((axfer->flags & DMATR_NO_SRC_INC) ? 1 : axfer->count);
+		SCB_CleanDCache_by_Addr((uint32_t *)axfer->srcaddr, len);
+	}
+
+	if (memdst)
+	{
+		bool sink = (0 != (axfer->flags & DMATR_NO_DST_INC));
+		unsigned len = axfer->bytewidth * (sink ? 1 : axfer->count);
+		if (cache_align_check && !sink && ((unsigned(axfer->dstaddr) | len) & (__SCB_DCACHE_LINE_SIZE - 1)))
+		{
+			// the neighboring data in the first / last cache line might be lost !
+			__DEBUG_BKPT();
+		}
+
+		// no dirty line may be evicted over the incoming data
+		SCB_CleanInvalidateDCache_by_Addr((uint32_t *)axfer->dstaddr, len);
+
+		if (0 == (axfer->flags & DMATR_CIRCULAR))
+		{
+			cacheinvaddr = axfer->dstaddr;
+			cacheinvlen = len;
+			cacheinvsink = sink;
+		}
+	}
+
+#endif
+}
+
+void THwDmaChannel::CacheInvalidateDst(THwDmaTransfer * axfer)
+{
+	if (istx && !(axfer->flags & DMATR_MEM_TO_MEM))
+	{
+		return;
+	}
+
+	if (axfer->flags & DMATR_NO_DST_INC)
+	{
+		mcu_dcache_clean_invalidate(axfer->dstaddr, axfer->bytewidth);
+	}
+	else
+	{
+		mcu_dcache_invalidate(axfer->dstaddr, axfer->bytewidth * axfer->count);
+	}
+}
+
+void THwDmaChannel::CacheFinish()
+{
+	// the cache might have loaded some destination lines speculatively during the transfer
+
+	if (cacheinvlen)
+	{
+		if (cacheinvsink)
+		{
+			mcu_dcache_clean_invalidate(cacheinvaddr, cacheinvlen);
+		}
+		else
+		{
+			mcu_dcache_invalidate(cacheinvaddr, cacheinvlen);
+		}
+		cacheinvlen = 0;
+	}
+
+	if (cacheinvchain)
+	{
+		THwDmaTransfer * first = cacheinvchain;
+		THwDmaTransfer * xfer = first;
+		cacheinvchain = nullptr;
+		while (xfer)
+		{
+			CacheInvalidateDst(xfer);
+			xfer = xfer->next;
+			if (xfer == first)  break;
+		}
+	}
+}
@@ -48,6 +48,8 @@ public:
 	uint8_t     bytewidth = 1;  // 1, 2 or 4
 	uint32_t    count = 0;
 	uint32_t    flags = 0;
+
+	THwDmaTransfer *  next = nullptr;  // for StartChain(), pointing back to the first makes an endless (ping-pong) chain
 };
 
 class THwDmaChannel_pre
@@ -109,11 +111,73 @@ public: // mandatory
 class THwDmaChannel : public HWDMACHANNEL_IMPL
 {
 public:
-	inline void StartTransfer(THwDmaTransfer * axfer)
+	// Transfers longer than HW_DMA_MAX_COUNT are chained: the next chunk is started by the Active()
+	// when the hardware finished the previous one, so the Active() must be polled (or called from the IRQ).
+	// The peripheral must tolerate the short pause between the chunks (flow controlled by the DMA requests).
+
+	THwDmaTransfer     chainxfer;           // the rest of a long transfer
+	uint32_t           chainremaining = 0;  // items not yet given to the hardware
+
+	void StartTransfer(THwDmaTransfer * axfer);
+	bool Active();
+
+	inline void Disable()
 	{
-		PrepareTransfer(axfer);
-		StartPreparedTransfer();
+		HWDMACHANNEL_IMPL::Disable();
+		chainremaining = 0;
+		curchainitem = nullptr;
+		CacheFinish();  // the destination might be partially written
 	}
+
+	inline bool Enabled()  // the end of the transfer is detected here too (drivers polling the Enabled())
+	{
+		if (HWDMACHANNEL_IMPL::Enabled())
+		{
+			return true;
+		}
+
+		if ((0 == chainremaining) && !(curchainitem && curchainitem->next))
+		{
+			CacheFinish();
+		}
+		return false;
+	}
+
+	// Descriptor chains: the transfers linked with the THwDmaTransfer::next are executed one after the other.
+	// Where the hardware supports linked descriptors (HWDMA_NATIVE_CHAIN) the chain runs without gaps,
+	// otherwise the next item is started by the Active(), which must be called from the DMA IRQ
+	// (set DMATR_IRQ on the items) or polled.
+	// The items must stay valid until the chain is running.
+
+	THwDmaTransfer *   curchainitem = nullptr;  // software chain: the running item
+
+	void StartChain(THwDmaTransfer * afirst);
+
+	// D-Cache maintenance (Cortex-M7 with enabled D-Cache): the memory source is cleaned before the transfer,
+	// the memory destination is cleaned + invalidated before and invalidated again when the Active(), Enabled()
+	// or Disable() detects the end. Software chains and long transfers continue only from the Active().
+	// The destination buffers should be cache line aligned (address and length), otherwise the CPU must not
+	// write the neighboring data during the transfer. The optional cache_align_check hits a breakpoint for
+	// unaligned destinations in DEBUG builds (only with a debugger attached!).
+	// Single item destinations (DMATR_NO_DST_INC, like the dummy receive bytes) are not checked, they are
+	// cleaned + invalidated at the end, so the neighboring data is kept but the received value might be lost.
+	// Circular receive transfers never end, there the data must be invalidated by the user before reading it.
+
+	bool               cache_maint = true;
+	bool               cache_align_check = false;
+
+protected:
+	void *             cacheinvaddr = nullptr;  // destination range to invalidate at the end
+	unsigned           cacheinvlen = 0;
+	bool               cacheinvsink = false;    // single item destination: clean + invalidate at the end
+	THwDmaTransfer *   cacheinvchain = nullptr; // native chains: all the items are invalidated at the end
+
+	void StartItem(THwDmaTransfer * axfer);
+	void StartNextChunk();
+
+	void CachePrepare(THwDmaTransfer * axfer);
+	void CacheFinish();
+	void CacheInvalidateDst(THwDmaTransfer * axfer);
 };
 
 #endif /* HWDMA_H_ */
@@ -0,0 +1,90 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwdmaman.cpp
+ *  brief:    DMA channel allocator with vendor specific request mapping
+ *  version:  1.00
+ *  date:     2021-08-11
+ *  authors:  nvitya
+*/
+
+#include "hwdmaman.h"
+
+THwDmaManager  hwdmaman;
+
+bool THwDmaManager_pre::Allocated(int adma, int achannel)
+{
+	if ((adma < 0) || (adma >= HWDMAMAN_MAX_CONTROLLERS) || (achannel < 0) || (achannel > 31))
+	{
+		return true;
+	}
+
+	return ((usedmask[adma] & (1u << achannel)) != 0);
+}
+
+void THwDmaManager_pre::Reserve(int adma, int achannel)
+{
+	if ((adma < 0) || (adma >= HWDMAMAN_MAX_CONTROLLERS) || (achannel < 0) || (achannel > 31))
+	{
+		return;
+	}
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+	usedmask[adma] |= (1u << achannel);
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+}
+
+void THwDmaManager_pre::Release(int adma, int achannel)
+{
+	if ((adma < 0) || (adma >= HWDMAMAN_MAX_CONTROLLERS) || (achannel < 0) || (achannel > 31))
+	{
+		return;
+	}
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+	usedmask[adma] &= ~(1u << achannel);
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+}
+
+int THwDmaManager_pre::FindFree(int adma, uint32_t achmask, int apriority)
+{
+	if ((adma < 0) || (adma >= HWDMAMAN_MAX_CONTROLLERS))
+	{
+		return -1;
+	}
+
+	uint32_t freemask = (achmask & ~usedmask[adma]);
+	if (!freemask)
+	{
+		return -1;
+	}
+
+	if (apriority > 0)
+	{
+		return __builtin_ctz(freemask);  // lowest channel number
+	}
+	else
+	{
+		return 31 - __builtin_clz(freemask);  // highest channel number
+	}
+}
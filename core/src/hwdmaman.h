@@ -0,0 +1,124 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwdmaman.h
+ *  brief:    DMA channel allocator with vendor specific request mapping
+ *  version:  1.00
+ *  date:     2021-08-11
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    The drivers request a channel for a peripheral request (e.g. DMARQ_SPI_TX(1)),
+ *    the allocator finds a free channel which can serve it and initializes the THwDmaChannel.
+ *    Channels initialized directly (with hard coded numbers) must be marked with Reserve().
+ *    Priority hint: higher priority requests get lower channel numbers, which win the
+ *    hardware arbitration on the same priority level.
+*/
+
+#ifndef HWDMAMAN_H_PRE_
+#define HWDMAMAN_H_PRE_
+
+#include "platform.h"
+#include "hwdma.h"
+
+// DMA request identification: peripheral type, device number (as in the driver Init()), direction
+
+#define DMARQ_TYPE_SPI      1
+#define DMARQ_TYPE_UART     2  // USART / UART
+#define DMARQ_TYPE_I2C      3
+#define DMARQ_TYPE_ADC      4
+#define DMARQ_TYPE_SDCARD   5
+#define DMARQ_TYPE_QSPI     6
+#define DMARQ_TYPE_DAC      7
+
+#define DMARQ(atype, adevnum, aistx)  (((atype) << 12) | (((adevnum) & 0x7FF) << 1) | ((aistx) ? 1 : 0))
+
+#define DMARQ_SPI_TX(n)     DMARQ(DMARQ_TYPE_SPI,    n, true)
+#define DMARQ_SPI_RX(n)     DMARQ(DMARQ_TYPE_SPI,    n, false)
+#define DMARQ_UART_TX(n)    DMARQ(DMARQ_TYPE_UART,   n, true)
+#define DMARQ_UART_RX(n)    DMARQ(DMARQ_TYPE_UART,   n, false)
+#define DMARQ_I2C_TX(n)     DMARQ(DMARQ_TYPE_I2C,    n, true)
+#define DMARQ_I2C_RX(n)     DMARQ(DMARQ_TYPE_I2C,    n, false)
+#define DMARQ_ADC(n)        DMARQ(DMARQ_TYPE_ADC,    n, false)
+#define DMARQ_SDCARD        DMARQ(DMARQ_TYPE_SDCARD, 1, false)  // same for both directions
+#define DMARQ_QSPI_TX       DMARQ(DMARQ_TYPE_QSPI,   1, true)
+#define DMARQ_QSPI_RX       DMARQ(DMARQ_TYPE_QSPI,   1, false)
+#define DMARQ_DAC(n)        DMARQ(DMARQ_TYPE_DAC,    n, true)
+
+#define HWDMAMAN_MAX_CONTROLLERS  4
+
+class THwDmaManager_pre
+{
+public:
+	uint32_t           usedmask[HWDMAMAN_MAX_CONTROLLERS] = {0};  // index = DMA controller number, bit = channel number
+
+	bool               Allocated(int adma, int achannel);
+	void               Reserve(int adma, int achannel);  // for the directly initialized channels
+	void               Release(int adma, int achannel);
+
+protected:
+	// returns the first free channel from the achmask (the last one for low priority), -1 if there is none
+	int                FindFree(int adma, uint32_t achmask, int apriority);
+};
+
+#endif // ndef HWDMAMAN_H_PRE_
+
+#ifndef HWDMAMAN_PRE_ONLY
+
+//-----------------------------------------------------------------------------
+
+#ifndef HWDMAMAN_H_
+#define HWDMAMAN_H_
+
+#include "mcu_impl.h"
+
+#ifndef HWDMAMAN_IMPL
+
+class THwDmaManager_noimpl : public THwDmaManager_pre
+{
+public: // mandatory
+	bool AllocChannel(THwDmaChannel * ach, unsigned arequest, int apriority)  { return false; }
+	void FreeChannel(THwDmaChannel * ach)  { }
+};
+
+#define HWDMAMAN_IMPL   THwDmaManager_noimpl
+
+#endif // ndef HWDMAMAN_IMPL
+
+//-----------------------------------------------------------------------------
+
+class THwDmaManager : public HWDMAMAN_IMPL
+{
+public:
+	// initializes the channel for the request, the apriority is stored into the channel priority too
+	inline bool Alloc(THwDmaChannel * ach, unsigned arequest, int apriority = 0)
+	{
+		return AllocChannel(ach, arequest, apriority);
+	}
+};
+
+extern THwDmaManager  hwdmaman;
+
+#endif // HWDMAMAN_H_
+
+#else
+  #undef HWDMAMAN_PRE_ONLY
+#endif
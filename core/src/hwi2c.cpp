@@ -50,3 +50,15 @@ int THwI2c::WaitFinish()
 
 	return error;
 }
+
+#ifndef HWI2C_OWN_CLOCKCHANGED
+
+void THwI2c::ClockChanged()
+{
+	if (initialized)
+	{
+		Init(devnum);
+	}
+}
+
+#endif
@@ -46,6 +46,8 @@
 #define I2CEX_3           0x03000000  // send 3 extra bytes
 #define I2CEX_MASK        0x03000000
 
+typedef void (* PI2cCompleteFunc)(void * arg);
+
 class THwI2c_pre
 {
 public:	// settings
@@ -69,6 +71,19 @@ public: // run state
 
 	bool           busy = false;
 	int            error = 0;
+
+public: // completion hook, called from the Run() when a transfer finished (busy became false)
+	PI2cCompleteFunc  completefunc = nullptr;
+	void *            completearg = nullptr;  // a new transfer can be started from the hook
+
+	inline void TransferFinished()
+	{
+		busy = false;
+		if (completefunc)
+		{
+			(* completefunc)(completearg);
+		}
+	}
 };
 
 #endif // ndef HWI2C_H_PRE_
@@ -107,6 +122,11 @@ class THwI2c : public HWI2C_IMPL
 public:
 	bool Finished();
 	int WaitFinish();
+
+#ifndef HWI2C_OWN_CLOCKCHANGED  // otherwise the driver has its own
+	void ClockChanged();  // recalculates the bus timing after a CPU speed change
+#endif
+	bool ClockChangeBusy()  { return busy; }  // transaction in progress
 };
 
 #endif // HWI2C_H_
@@ -0,0 +1,131 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwlowpower.cpp
+ *  brief:    Low power (sleep / deep sleep) mode vendor-independent implementations
+ *  version:  1.00
+ *  date:     2021-08-14
+ *  authors:  nvitya
+*/
+
+#include "platform.h"
+#include "hwlowpower.h"
+
+THwLowPower  hwlowpower;
+
+void THwLowPower::Sleep()
+{
+	++sleep_count;
+
+	__DSB();
+	__WFI();
+}
+
+bool THwLowPower::SysTickSleep(unsigned aclocks, unsigned aminclocks)
+{
+	// the SysTick might be used by others, its state is restored at the end
+	uint32_t saved_ctrl = SysTick->CTRL;
+	uint32_t saved_load = SysTick->LOAD;
+	uint32_t saved_val  = SysTick->VAL;
+	bool     periodic = (0 != (saved_ctrl & SysTick_CTRL_ENABLE_Msk));
+
+	if (periodic && (saved_val < aclocks))
+	{
+		aclocks = saved_val;  // the periodic tick must not be missed
+	}
+	if (aclocks > SysTick_LOAD_RELOAD_Msk)  aclocks = SysTick_LOAD_RELOAD_Msk;
+	if ((aclocks < aminclocks) || (aclocks < 2))
+	{
+		return false;
+	}
+
+	clockcnt_t tstart = CLOCKCNT;
+	clockcnt_t tdeadline = tstart + aclocks;
+
+	SysTick->CTRL = 0;
+	SysTick->LOAD = aclocks;
+	SysTick->VAL  = 0;
+	SysTick->CTRL = (SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk);
+
+	Sleep();
+
+	clockcnt_t tend = CLOCKCNT;
+	systick_late_clocks = int(tend - tdeadline);
+
+	SysTick->CTRL = 0;
+
+	if (periodic)
+	{
+		// continue the periodic tick with its original phase
+		unsigned elapsed = ELAPSEDCLOCKS(tend, tstart);
+		unsigned remaining;
+		if (elapsed < saved_val)
+		{
+			remaining = saved_val - elapsed;
+		}
+		else
+		{
+			unsigned period = saved_load + 1;
+			remaining = period - ((elapsed - saved_val) % period);
+		}
+		if (remaining < 16)  remaining = 16;  // must be visible in the VAL below
+
+		SysTick->LOAD = remaining;
+		SysTick->VAL  = 0;  // reload now
+		SysTick->CTRL = saved_ctrl;
+		while (0 == SysTick->VAL)
+		{
+			// wait until the remaining is loaded
+		}
+		SysTick->LOAD = saved_load;  // for the next periods
+	}
+	else
+	{
+		SysTick->LOAD = saved_load;
+		SysTick->VAL  = 0;
+		SysTick->CTRL = saved_ctrl;
+	}
+
+	return true;
+}
+
+void THwLowPower::DeepSleep()
+{
+	if (!DeepSleepSupported())
+	{
+		Sleep();
+		return;
+	}
+
+	++deepsleep_count;
+
+	EnterDeepSleep();
+
+	clockcnt_t t0 = CLOCKCNT;
+
+	RestoreAfterDeepSleep();
+
+	wakeup_clocks = ELAPSEDCLOCKS(CLOCKCNT, t0);
+	if (wakeup_clocks > wakeup_clocks_max)
+	{
+		wakeup_clocks_max = wakeup_clocks;
+	}
+}
@@ -0,0 +1,103 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwlowpower.h
+ *  brief:    Low power (sleep / deep sleep) mode vendor-independent definitions
+ *  version:  1.00
+ *  date:     2021-08-14
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    Both Sleep() and DeepSleep() must be called with disabled interrupts (PRIMASK),
+ *    the pending interrupts wake up the CPU, and they are served after the mcu_enable_interrupts().
+ *    The deep sleep stops the CPU clock (STOP / wait / deep sleep modes) but keeps the RAM and the
+ *    peripheral registers. The CLOCKCNT does not run during the deep sleep, so the deep sleep
+ *    requires some other wake up source (RTC, low power timer, pin IRQ).
+ *    The clocks are restored with the hwclkctrl.RestoreCpuClock() when the mode stopped the PLLs.
+ *    The optional wake up timer (StartWakeupTimer / StopWakeupTimer) runs during the deep sleep,
+ *    the implementations without it return false from the StartWakeupTimer().
+*/
+
+#ifndef HWLOWPOWER_H_PRE_
+#define HWLOWPOWER_H_PRE_
+
+#include "platform.h"
+#include "clockcnt.h"
+
+class THwLowPower_pre
+{
+public: // statistics
+	unsigned           sleep_count = 0;
+	unsigned           deepsleep_count = 0;
+	unsigned           wakeup_clocks = 0;      // CPU clocks from the deep sleep wake up to running (clocks restored)
+	unsigned           wakeup_clocks_max = 0;
+	int                systick_late_clocks = 0; // SysTickSleep(): from the deadline to running, negative = woken earlier
+
+public: // optional low power wake up timer, overridden by the implementations which have it
+	bool               StartWakeupTimer(unsigned aus)  { return false; }  // false = not available
+	unsigned           StopWakeupTimer()               { return 0; }      // returns the elapsed time in us
+};
+
+#endif // ndef HWLOWPOWER_H_PRE_
+
+#ifndef HWLOWPOWER_PRE_ONLY
+
+//-----------------------------------------------------------------------------
+
+#ifndef HWLOWPOWER_H_
+#define HWLOWPOWER_H_
+
+#include "mcu_impl.h"
+
+#ifndef HWLOWPOWER_IMPL
+
+class THwLowPower_noimpl : public THwLowPower_pre
+{
+public: // mandatory
+	bool DeepSleepSupported()       { return false; }
+
+	void EnterDeepSleep()           { }  // returns after the wake up, the clocks might be reduced
+	void RestoreAfterDeepSleep()    { }
+};
+
+#define HWLOWPOWER_IMPL   THwLowPower_noimpl
+
+#endif // ndef HWLOWPOWER_IMPL
+
+//-----------------------------------------------------------------------------
+
+class THwLowPower : public HWLOWPOWER_IMPL
+{
+public:
+	void Sleep();      // WFI, the clocks are running
+	// WFI with one-shot SysTick wake up. The SysTick state is restored afterwards, a running periodic
+	// SysTick (pcprof, clockcnt64) limits the sleep to its next tick and continues with its phase.
+	bool SysTickSleep(unsigned aclocks, unsigned aminclocks = 0);  // false = not slept (too short)
+	void DeepSleep();  // falls back to Sleep() when not supported
+};
+
+extern THwLowPower  hwlowpower;
+
+#endif // HWLOWPOWER_H_
+
+#else
+  #undef HWLOWPOWER_PRE_ONLY
+#endif
@@ -66,6 +66,7 @@
 #define QSPICM_MODE2      0x20000000  // 2 mode bytes
 #define QSPICM_MODE3      0x30000000  // 3 mode bytes
 #define QSPICM_MODE4      0x40000000  // 4 mode bytes
+#define QSPICM_MODE_MASK  0xF0000000
 
 
 class THwQspi_pre
@@ -84,6 +85,8 @@ public:	// settings
 	unsigned       dummydata = 0;
 
 	unsigned       multi_line_count = 2;  // 4 = quad, 2 = dual mode, 1 = disable multi line mode
+	unsigned       memsize = 0x1000000;  // flash size in bytes, some implementations limit the accessible range with it
+	unsigned       maxdatalen = HW_DMA_MAX_COUNT;  // maximal data length of one command (set by the implementation)
 
 public: // Required HW resources
 	THwDmaChannel  txdma;
@@ -99,11 +102,14 @@ public: // run state
 	unsigned       remainingbytes = 0;
 
 	bool           busy = false;
+	bool           memmapped = false;  // the flash is mapped into the CPU address space
 
 public:
 	virtual        ~THwQspi_pre() { } // virtual destructor to avoid compiler warning
 
 	virtual bool   InitInterface() { return true; }
+
+	void           SetMemorySize(unsigned abytesize) { memsize = abytesize; }
 };
 
 #endif // ndef HWQSPI_H_PRE_
@@ -128,7 +134,8 @@ public: // mandatory
 
 	int  StartReadData(unsigned acmd, unsigned address, void * dstptr, unsigned len)   { return ERROR_NOTIMPL; }
 	int  StartWriteData(unsigned acmd, unsigned address, void * srcptr, unsigned len)  { return ERROR_NOTIMPL; }
-	void SetMemMappedMode() { }
+	bool SetMemMappedMode(unsigned acmd, bool acontinuous) { return false; }
+	void SetIndirectMode() { }
 	void Run()  { }
 };
 
@@ -67,7 +67,17 @@ void THwSdcard::Run()
 		return;
 	}
 
+	bool wascompleted = completed;
+
 	RunTransfer(); // run transfer state machine
+
+	if (!wascompleted && completed && errorcode && speed_fallback && (cur_clockspeed > clockspeed))
+	{
+		// the raised clock might be too much for the wiring / card
+		SetSpeed(clockspeed);
+		cur_clockspeed = clockspeed;
+		TRACE("SDCARD transfer error, clock reduced to %u Hz\r\n", clockspeed);
+	}
 }
 
 void THwSdcard::RunInitialization()
@@ -89,12 +99,16 @@ void THwSdcard::RunInitialization()
 	case 0: // send init clocks
 
 		// required low settings for the initialization
+		high_speed = false;
 		SetSpeed(initial_speed); // initial speed = 400 kHz
 		SetBusWidth(1);
 
 		card_present = false;
 		high_capacity = false;
 		card_v2 = false;
+		cur_clockspeed = initial_speed;
+		card_busy = false;
+		stream_open = false;
 
 		//SendCmd(1, 0, SDCMD_RES_NO | SDCMD_OPENDRAIN); // never fails
 		++initstate;
@@ -292,6 +306,7 @@ void THwSdcard::RunInitialization()
 		else
 		{
 			SetSpeed(clockspeed);
+			cur_clockspeed = clockspeed;
 			SetBusWidth(bus_width);
 			++initstate;
 		}
@@ -306,7 +321,83 @@ void THwSdcard::RunInitialization()
 		if (cmderror)		initstate = 100;
 		else
 		{
-			TRACE("SDCARD initialized, ready to accept transfer commands.\r\n");
+			initstate = 34;
+		}
+		break;
+
+	// High-Speed negotiation
+	case 34:
+		// CMD6 requires SD spec. 1.10+ (SCR) and command class 10 (CSD)
+		if (!hs_enable || ((reg_scr[0] & 0x0F) < 1) || (0 == (GetRegBits(&reg_csd[0], 84, 12) & (1 << 10))))
+		{
+			initstate = 39; RunInitialization(); return;  // phase jump
+		}
+
+		StartDataReadCmd(6, 0x00FFFFF1, SDCMD_RES_48BIT, &reg_swstat[0], sizeof(reg_swstat)); // check function, group 1 = 1 (HS)
+		++initstate;
+		break;
+
+	case 35:
+		if (cmderror)
+		{
+			initstate = 39;
+		}
+		else if (!dma.initialized || !dma.Active())
+		{
+			// group 1 support bits: 415..400, selection result: 379..376
+			if ((reg_swstat[13] & 0x02) && (1 == (reg_swstat[16] & 0x0F)))
+			{
+				++initstate;
+			}
+			else
+			{
+				TRACE("SDCARD High-Speed mode is not supported.\r\n");
+				initstate = 39;
+			}
+		}
+		break;
+
+	case 36:
+		StartDataReadCmd(6, 0x80FFFFF1, SDCMD_RES_48BIT, &reg_swstat[0], sizeof(reg_swstat)); // switch function
+		++initstate;
+		break;
+
+	case 37:
+		if (cmderror)
+		{
+			initstate = 39;
+		}
+		else if (!dma.initialized || !dma.Active())
+		{
+			if (1 == (reg_swstat[16] & 0x0F))
+			{
+				high_speed = true;
+				csd_max_speed = 50000000;  // the TRAN_SPEED changes to 50 MHz after the switch
+				TRACE("SDCARD switched to High-Speed mode\r\n");
+			}
+			initstate = 38;
+			lastcmdtime = CLOCKCNT;
+		}
+		break;
+
+	case 38: // the card switches after the status block, give it some time
+		if (CLOCKCNT - lastcmdtime > SystemCoreClock / 100000)  // 10 us
+		{
+			++initstate;
+		}
+		break;
+
+	case 39: // set the final clock speed
+		{
+			uint32_t speed = (high_speed ? hs_clockspeed : clockspeed);
+			if (csd_max_speed && (speed > csd_max_speed))
+			{
+				speed = csd_max_speed;
+			}
+			SetSpeed(speed);
+			cur_clockspeed = speed;
+
+			TRACE("SDCARD initialized, clock = %u Hz, ready to accept transfer commands.\r\n", speed);
 			initstate = 50;
 		}
 		break;
@@ -419,7 +510,7 @@ bool THwSdcard::StartReadBlocks(uint32_t astartblock, void * adataptr, uint32_t
 		return false;
 	}
 
-	if (!completed)
+	if (!completed || stream_open)
 	{
 		errorcode = ERROR_BUSY;  // this might be overwriten later
 		return false;
@@ -433,6 +524,7 @@ bool THwSdcard::StartReadBlocks(uint32_t astartblock, void * adataptr, uint32_t
 
 	errorcode = 0;
 	completed = false;
+	trwrite = false;
 
 	trstate = 1; // read blocks
 
@@ -450,7 +542,7 @@ bool THwSdcard::StartWriteBlocks(uint32_t astartblock, void * adataptr, uint32_t
 		return false;
 	}
 
-	if (!completed)
+	if (!completed || stream_open)
 	{
 		errorcode = ERROR_BUSY;  // this might be overwriten later
 		return false;
@@ -464,6 +556,7 @@ bool THwSdcard::StartWriteBlocks(uint32_t astartblock, void * adataptr, uint32_t
 
 	errorcode = 0;
 	completed = false;
+	trwrite = true;
 
 	trstate = 11; // write blocks
 
@@ -472,6 +565,80 @@ bool THwSdcard::StartWriteBlocks(uint32_t astartblock, void * adataptr, uint32_t
 	return (errorcode == 0);
 }
 
+bool THwSdcard::StartStreamWrite(uint32_t astartblock, void * adataptr, uint32_t ablockcount, uint32_t aprecount)
+{
+	if (!initialized)
+	{
+		errorcode = ERROR_NOTINIT;
+		completed = true;
+		return false;
+	}
+
+	if (!completed || stream_open)
+	{
+		errorcode = ERROR_BUSY;  // this might be overwriten later
+		return false;
+	}
+
+	dataptr = (uint8_t *)adataptr;
+	blockcount = ablockcount;
+	remainingblocks = ablockcount;
+	startblock = astartblock;
+	curblock = astartblock;
+	stream_precount = aprecount;  // ACMD23 pre-erase block count, 0 = unknown
+
+	errorcode = 0;
+	completed = false;
+	trwrite = true;
+
+	trstate = 21; // open stream
+
+	Run();
+
+	return (errorcode == 0);
+}
+
+bool THwSdcard::ContinueStreamWrite(void * adataptr, uint32_t ablockcount)
+{
+	if (!stream_open || !completed)
+	{
+		errorcode = (stream_open ? ERROR_BUSY : ERROR_NOTINIT);
+		return false;
+	}
+
+	curblock += blockcount;
+	dataptr = (uint8_t *)adataptr;
+	blockcount = ablockcount;
+	remainingblocks = ablockcount;
+
+	errorcode = 0;
+	completed = false;
+
+	trstate = 31; // continue stream
+
+	Run();
+
+	return (errorcode == 0);
+}
+
+bool THwSdcard::StopStreamWrite()
+{
+	if (!stream_open || !completed)
+	{
+		errorcode = (stream_open ? ERROR_BUSY : ERROR_NOTINIT);
+		return false;
+	}
+
+	errorcode = 0;
+	completed = false;
+
+	trstate = 41; // close stream
+
+	Run();
+
+	return (errorcode == 0);
+}
+
 void THwSdcard::WaitForComplete()
 {
 	while (!completed)
@@ -479,3 +646,11 @@ void THwSdcard::WaitForComplete()
 		Run();
 	}
 }
+
+void THwSdcard::ClockChanged()
+{
+	if (initialized && cur_clockspeed)
+	{
+		SetSpeed(cur_clockspeed);
+	}
+}
@@ -46,12 +46,17 @@ class THwSdcard_pre
 {
 public:
 	int           devnum = -1;
-	bool          high_speed = false;
+	bool          high_speed = false;  // set by the initialization when the card was switched to High-Speed mode
 
 	uint8_t       bus_width = 4;
 	uint32_t      initial_speed = 400000; // 400 kHz is the maximum
 	uint32_t      clockspeed  = 20000000;  // 20 MHz by default
 
+	bool          hs_enable = true;          // try to switch the card to High-Speed mode (CMD6)
+	uint32_t      hs_clockspeed = 50000000;  // used in High-Speed mode, limited by the csd_max_speed
+	bool          speed_fallback = true;     // go back to clockspeed after a transfer error
+	uint32_t      cur_clockspeed = 0;
+
 	bool          initialized = false;
 
 	uint32_t      cmdtimeout = 0;
@@ -71,6 +76,15 @@ public:
 	uint32_t      blockcount = 0;
 	int           remainingblocks = 0;
 	uint8_t *     dataptr = nullptr;
+	bool          trwrite = false;
+
+	uint32_t      rca = 0;      // relative card address, required for point-to-point communication
+
+	bool          write_preerase = true;  // send ACMD23 before multi-block writes
+	bool          card_busy = false;      // the card might still program the last write
+	int           busy_trstate = 0;       // transfer state to continue after the busy polling
+	bool          stream_open = false;    // open ended CMD25 write is active
+	uint32_t      stream_precount = 0;
 
 	bool        	completed = true;
   int         	errorcode = 0;
@@ -94,7 +108,11 @@ public:
 #ifndef HWSDCARD_H_
 #define HWSDCARD_H_
 
-#include "mcu_impl.h"
+#ifdef HWSDCARD_SPI
+  #include "hwsdcard_spi.h"  // SPI mode instead of the native interface
+#else
+  #include "mcu_impl.h"
+#endif
 
 #ifndef HWSDCARD_IMPL
 
@@ -128,12 +146,12 @@ public: // mandatory
 class THwSdcard : public HWSDCARD_IMPL
 {
 public:
-	uint32_t    rca = 0;      // relative card address, required for point-to-point communication
 	uint32_t    reg_ocr = 0;  // Card Operating Condition + status register
 
 	uint8_t     reg_cid[16]  __attribute__((aligned(4)));  // Card Identification Register
 	uint8_t     reg_csd[16]  __attribute__((aligned(4)));  // Card Specific Data Register
 	uint8_t     reg_scr[8]   __attribute__((aligned(4)));  // SD Configuration Register
+	uint8_t     reg_swstat[64]  __attribute__((aligned(4)));  // CMD6 switch function status
 
 	uint8_t     csd_ver = 0;
 	uint32_t    csd_max_speed = 0;
@@ -142,6 +160,7 @@ public:
 
   bool        Init();
   void        Run(); // operate the state machine
+  void        ClockChanged();  // recalculates the SD clock divider after a CPU speed change
   void        RunInitialization();
 
 public:
@@ -152,6 +171,11 @@ public:
 
   bool        StartReadBlocks(uint32_t astartblock, void * adataptr, uint32_t ablockcount);
   bool        StartWriteBlocks(uint32_t astartblock, void * adataptr, uint32_t ablockcount);
+
+  // open ended multi-block write: the CMD25 stays open between the buffers
+  bool        StartStreamWrite(uint32_t astartblock, void * adataptr, uint32_t ablockcount, uint32_t aprecount = 0);
+  bool        ContinueStreamWrite(void * adataptr, uint32_t ablockcount);
+  bool        StopStreamWrite();
 	void 				WaitForComplete();
 };
 
@@ -0,0 +1,694 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwsdcard_spi.cpp
+ *  brief:    SPI mode SDCARD driver, alternative implementation for the THwSdcard
+ *  version:  1.00
+ *  date:     2021-08-10
+ *  authors:  nvitya
+*/
+
+#include "platform.h"
+#include "hwsdcard.h"
+#include "clockcnt.h"
+#include "errors.h"
+
+#include "traces.h"
+
+#ifdef HWSDCARD_SPI
+
+#define SDSPI_TOKEN_START        0xFE  // single block read / write, multi block read
+#define SDSPI_TOKEN_START_MULTI  0xFC  // multi block write
+#define SDSPI_TOKEN_STOP_MULTI   0xFD
+
+static uint8_t sd_crc7(uint8_t * pdata, unsigned len)
+{
+	uint8_t crc = 0;
+	while (len > 0)
+	{
+		uint8_t d = *pdata++;
+		for (unsigned n = 0; n < 8; ++n)
+		{
+			crc <<= 1;
+			if ((d ^ crc) & 0x80)  crc ^= 0x09;
+			d <<= 1;
+		}
+		--len;
+	}
+	return (crc << 1) | 1;
+}
+
+static uint16_t sd_crc16(uint8_t * pdata, unsigned len)
+{
+	uint16_t crc = 0;
+	while (len > 0)
+	{
+		crc ^= (*pdata++ << 8);
+		for (unsigned n = 0; n < 8; ++n)
+		{
+			crc = ((crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1));
+		}
+		--len;
+	}
+	return crc;
+}
+
+bool THwSdcard_spi::HwInit()
+{
+	if (!spi || !spi->initialized || !cspin)
+	{
+		return false;
+	}
+
+	if (!spi->txdma || !spi->rxdma)
+	{
+		return false;  // DMA is mandatory
+	}
+
+	cspin->Set1();
+	SetSpeed(initial_speed);
+
+	return true;
+}
+
+void THwSdcard_spi::SetSpeed(uint32_t speed)
+{
+	if (spi->speed != speed)
+	{
+		spi->speed = speed;
+		spi->ClockChanged();  // re-applies the speed, keeps the DMA assignments
+	}
+}
+
+void THwSdcard_spi::Select()
+{
+	cspin->Set0();
+}
+
+void THwSdcard_spi::Deselect()
+{
+	cspin->Set1();
+	SpiXchg(0xFF);  // the card releases the MISO only with the next clocks
+}
+
+uint8_t THwSdcard_spi::SpiXchg(uint8_t adata)
+{
+	unsigned short rxdata = 0xFF;
+	spi->SendData(adata);
+	unsigned t0 = CLOCKCNT;
+	while (!spi->TryRecvData(&rxdata))
+	{
+		if (CLOCKCNT - t0 > SystemCoreClock / 1000)  // 1 ms, much longer than a byte at the lowest speed
+		{
+			return 0xFF;
+		}
+	}
+	return rxdata;
+}
+
+uint8_t THwSdcard_spi::Command(uint8_t acmd, uint32_t aarg)  // returns R1
+{
+	uint8_t cmdbuf[6];
+
+	cmdbuf[0] = 0x40 | acmd;
+	cmdbuf[1] = (aarg >> 24);
+	cmdbuf[2] = (aarg >> 16);
+	cmdbuf[3] = (aarg >>  8);
+	cmdbuf[4] = (aarg >>  0);
+	cmdbuf[5] = sd_crc7(&cmdbuf[0], 5);
+
+	SpiXchg(0xFF);
+	for (unsigned n = 0; n < 6; ++n)
+	{
+		SpiXchg(cmdbuf[n]);
+	}
+
+	if (12 == acmd)
+	{
+		SpiXchg(0xFF);  // skip the stuff byte
+	}
+
+	// the response arrives in 1-8 bytes
+	uint8_t r1 = 0xFF;
+	for (unsigned n = 0; n < 10; ++n)
+	{
+		r1 = SpiXchg(0xFF);
+		if (0 == (r1 & 0x80))
+		{
+			break;
+		}
+	}
+
+	lastcmdtime = CLOCKCNT;
+	return r1;
+}
+
+bool THwSdcard_spi::ReadDataSync(void * adst, unsigned alen)  // only for the short register reads
+{
+	uint8_t * dst = (uint8_t *)adst;
+	uint8_t b;
+
+	unsigned t0 = CLOCKCNT;
+	do
+	{
+		b = SpiXchg(0xFF);
+		if (CLOCKCNT - t0 > SystemCoreClock / 10)  // 100 ms
+		{
+			return false;
+		}
+	}
+	while (0xFF == b);
+
+	if (SDSPI_TOKEN_START != b)
+	{
+		return false;
+	}
+
+	for (unsigned n = 0; n < alen; ++n)
+	{
+		dst[n] = SpiXchg(0xFF);
+	}
+
+	crcbuf[0] = SpiXchg(0xFF);
+	crcbuf[1] = SpiXchg(0xFF);
+
+	if (crc_enabled && (sd_crc16(dst, alen) != ((crcbuf[0] << 8) | crcbuf[1])))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+void THwSdcard_spi::SendCmd(uint8_t acmd, uint32_t cmdarg, uint32_t cmdflags)
+{
+	uint8_t r1;
+
+	curcmd = acmd;
+	curcmdarg = cmdarg;
+	curcmdflags = cmdflags;
+
+	cmderror = false;
+	cmdrunning = false;
+	cmdresult = 0;
+	lastcmdtime = CLOCKCNT;
+
+	if (55 == acmd)
+	{
+		// sent together with the following command, because some native ACMDs are skipped
+		appcmd_pending = true;
+		return;
+	}
+
+	bool isappcmd = appcmd_pending;
+	appcmd_pending = false;
+
+	if (isappcmd && (6 == acmd))
+	{
+		return; // ACMD6 = set bus width: not supported in SPI mode
+	}
+
+	if ((3 == acmd) || (7 == acmd))
+	{
+		return; // RCA / card select: not used in SPI mode
+	}
+
+	if (0 == acmd)
+	{
+		// at least 74 clocks with CS high to enter the SPI mode
+		cspin->Set1();
+		for (unsigned n = 0; n < 10; ++n)
+		{
+			SpiXchg(0xFF);
+		}
+	}
+
+	Select();
+
+	if (isappcmd)
+	{
+		r1 = Command(55, 0);
+		if (r1 & 0xFE)
+		{
+			cmderror = true;
+			Deselect();
+			return;
+		}
+	}
+
+	if (2 == acmd)
+	{
+		acmd = 10;  // CID read in SPI mode
+	}
+
+	if (41 == acmd)
+	{
+		cmdarg &= (1u << 30);  // only the HCS bit is valid in SPI mode
+	}
+
+	r1 = Command(acmd, cmdarg);
+	if (r1 & 0xFE)
+	{
+		cmderror = true;
+		Deselect();
+		return;
+	}
+
+	if (8 == acmd)
+	{
+		// R7
+		for (unsigned n = 0; n < 4; ++n)
+		{
+			cmdresult = (cmdresult << 8) | SpiXchg(0xFF);
+		}
+	}
+	else if (41 == acmd)
+	{
+		if (0 == r1)
+		{
+			// initialization finished, the OCR must be read with CMD58
+			r1 = Command(58, 0);
+			if (r1 & 0xFE)
+			{
+				cmderror = true;
+			}
+			else
+			{
+				for (unsigned n = 0; n < 4; ++n)
+				{
+					cmdresult = (cmdresult << 8) | SpiXchg(0xFF);
+				}
+				cmdresult |= 0x80000000;
+			}
+		}
+		// else cmdresult = 0: still in idle state
+	}
+	else if ((10 == acmd) || (9 == acmd))
+	{
+		// CID, CSD: data block in SPI mode
+		if (!ReadDataSync(&regdata[0], 16))
+		{
+			cmderror = true;
+		}
+	}
+	else if (16 == acmd)
+	{
+		// the last initialization command, set the CRC mode here too
+		if (Command(59, (crc_enabled ? 1 : 0)) & 0xFE)
+		{
+			cmderror = true;
+		}
+	}
+
+	Deselect();
+}
+
+void THwSdcard_spi::GetCmdResult128(void * adataptr)
+{
+	// convert to the native R2 layout: little endian words, the last word first
+	uint32_t * dst = (uint32_t *)adataptr;
+	for (unsigned n = 0; n < 4; ++n)
+	{
+		uint8_t * src = &regdata[(3 - n) << 2];
+		dst[n] = (src[0] << 24) | (src[1] << 16) | (src[2] << 8) | src[3];
+	}
+}
+
+void THwSdcard_spi::StartDataReadCmd(uint8_t acmd, uint32_t cmdarg, uint32_t cmdflags, void * dataptr, uint32_t datalen)
+{
+	// only used for the short register reads (SCR, switch status), executed synchronously
+
+	curcmd = acmd;
+	curcmdarg = cmdarg;
+	curcmdflags = cmdflags;
+
+	cmderror = false;
+	cmdrunning = false;
+
+	bool isappcmd = appcmd_pending;
+	appcmd_pending = false;
+
+	Select();
+
+	if (isappcmd && (Command(55, 0) & 0xFE))
+	{
+		cmderror = true;
+	}
+	else if (Command(acmd, cmdarg) & 0xFE)
+	{
+		cmderror = true;
+	}
+	else if (!ReadDataSync(dataptr, datalen))
+	{
+		cmderror = true;
+	}
+
+	Deselect();
+}
+
+void THwSdcard_spi::StartDataWriteCmd(uint8_t acmd, uint32_t cmdarg, uint32_t cmdflags, void * dataptr, uint32_t datalen)
+{
+	// single block write, executed synchronously
+
+	uint8_t * src = (uint8_t *)dataptr;
+
+	curcmd = acmd;
+	curcmdarg = cmdarg;
+	curcmdflags = cmdflags;
+
+	cmderror = false;
+	errorcode = 0;
+	cmdrunning = false;
+	appcmd_pending = false;
+
+	Select();
+
+	if (Command(acmd, cmdarg) & 0xFE)
+	{
+		cmderror = true;
+		Deselect();
+		return;
+	}
+
+	uint16_t crc = (crc_enabled ? sd_crc16(src, datalen) : 0xFFFF);
+
+	SpiXchg(0xFF);
+	SpiXchg(SDSPI_TOKEN_START);
+	for (unsigned n = 0; n < datalen; ++n)
+	{
+		SpiXchg(src[n]);
+	}
+	SpiXchg(crc >> 8);
+	SpiXchg(crc & 0xFF);
+
+	if ((SpiXchg(0xFF) & 0x1F) != 0x05)  // data accepted ?
+	{
+		cmderror = true;
+		errorcode = ERROR_WRITE;
+	}
+
+	unsigned t0 = CLOCKCNT;
+	while (0 == SpiXchg(0xFF))
+	{
+		if (CLOCKCNT - t0 > SystemCoreClock / 4)  // 250 ms, the SD write busy limit
+		{
+			cmderror = true;
+			errorcode = ERROR_TIMEOUT;
+			break;
+		}
+	}
+
+	Deselect();
+}
+
+void THwSdcard_spi::StartBlockDma(bool istx)
+{
+	txfer.bytewidth = 1;
+	txfer.count = 512;
+	rxfer.bytewidth = 1;
+	rxfer.count = 512;
+
+	if (istx)
+	{
+		txfer.srcaddr = dataptr;
+		txfer.flags = 0;
+		rxfer.dstaddr = &dummy_rx;
+		rxfer.flags = DMATR_NO_ADDR_INC;  // ignore the received data
+	}
+	else
+	{
+		dummy_tx = 0xFF;
+		txfer.srcaddr = &dummy_tx;
+		txfer.flags = DMATR_NO_ADDR_INC;  // sending 0xFF all the time
+		rxfer.dstaddr = dataptr;
+		rxfer.flags = 0;
+	}
+
+	spi->DmaStartRecv(&rxfer);
+	spi->DmaStartSend(&txfer);
+}
+
+void THwSdcard_spi::FinishTransfer(int aerror)
+{
+	if (!stream_open || aerror)
+	{
+		Deselect();
+		stream_open = false;
+	}
+
+	errorcode = aerror;
+	completed = true;
+	trstate = 0;
+}
+
+void THwSdcard_spi::RunTransfer()
+{
+	uint8_t  b;
+	uint32_t addr = curblock;
+	if (!high_capacity)  addr <<= 9; // byte addressing for low capacity cards
+
+	if (card_busy && ((1 == trstate) || (11 == trstate) || (21 == trstate) || (31 == trstate) || (41 == trstate)))
+	{
+		// the card might still program the previous write
+		Select();
+		if (SpiXchg(0xFF) != 0xFF)
+		{
+			if (CLOCKCNT - waitstart > SystemCoreClock / 2)  // 500 ms
+			{
+				card_busy = false;
+				FinishTransfer(ERROR_TIMEOUT);
+			}
+			return;
+		}
+		card_busy = false;
+	}
+
+	switch (trstate)
+	{
+	case 0: // idle
+		break;
+
+	// read
+
+	case 1: // start read blocks
+		Select();
+		if (Command((blockcount > 1 ? 18 : 17), addr))
+		{
+			FinishTransfer(ERROR_READ);
+			return;
+		}
+		waitstart = CLOCKCNT;
+		trstate = 2;
+		break;
+
+	case 2: // wait for the data token
+		b = SpiXchg(0xFF);
+		if (0xFF == b)
+		{
+			if (CLOCKCNT - waitstart > SystemCoreClock / 10)  // 100 ms
+			{
+				FinishTransfer(ERROR_TIMEOUT);
+			}
+			return;
+		}
+
+		if (SDSPI_TOKEN_START != b)
+		{
+			FinishTransfer(ERROR_READ);  // data error token
+			return;
+		}
+
+		StartBlockDma(false);
+		trstate = 3;
+		break;
+
+	case 3: // wait for the block data
+		if (!spi->DmaRecvCompleted())
+		{
+			return;
+		}
+
+		crcbuf[0] = SpiXchg(0xFF);
+		crcbuf[1] = SpiXchg(0xFF);
+		if (crc_enabled && (sd_crc16(dataptr, 512) != ((crcbuf[0] << 8) | crcbuf[1])))
+		{
+			if (blockcount > 1)  Command(12, 0);
+			FinishTransfer(ERROR_READ);
+			return;
+		}
+
+		dataptr += 512;
+		--remainingblocks;
+		if (remainingblocks > 0)
+		{
+			waitstart = CLOCKCNT;
+			trstate = 2;
+			return;
+		}
+
+		if (blockcount > 1)
+		{
+			Command(12, 0);  // stop transmission
+			card_busy = true;
+			waitstart = CLOCKCNT;
+		}
+		FinishTransfer(0);
+		break;
+
+	// write
+
+	case 11: // start write blocks
+		Select();
+		if ((blockcount > 1) && write_preerase)
+		{
+			Command(55, 0);
+			Command(23, (blockcount & 0x7FFFFF));  // ACMD23: SET_WR_BLK_ERASE_COUNT, only a hint
+		}
+
+		if (Command((blockcount > 1 ? 25 : 24), addr))
+		{
+			FinishTransfer(ERROR_WRITE);
+			return;
+		}
+		trstate = 12;
+		break;
+
+	case 12: // send the next block
+		SpiXchg(0xFF);
+		SpiXchg(((blockcount > 1) || stream_open) ? SDSPI_TOKEN_START_MULTI : SDSPI_TOKEN_START);
+
+		if (crc_enabled)
+		{
+			uint16_t crc = sd_crc16(dataptr, 512);
+			crcbuf[0] = (crc >> 8);
+			crcbuf[1] = (crc & 0xFF);
+		}
+		else
+		{
+			crcbuf[0] = 0xFF;
+			crcbuf[1] = 0xFF;
+		}
+
+		StartBlockDma(true);
+		trstate = 13;
+		break;
+
+	case 13: // wait until the block sent
+		if (!spi->DmaRecvCompleted())
+		{
+			return;
+		}
+
+		SpiXchg(crcbuf[0]);
+		SpiXchg(crcbuf[1]);
+
+		if ((SpiXchg(0xFF) & 0x1F) != 0x05)  // data accepted ?
+		{
+			if ((blockcount > 1) || stream_open)
+			{
+				SpiXchg(SDSPI_TOKEN_STOP_MULTI);
+			}
+			card_busy = true;
+			waitstart = CLOCKCNT;
+			stream_open = false;
+			FinishTransfer(ERROR_WRITE);
+			return;
+		}
+
+		dataptr += 512;
+		--remainingblocks;
+
+		waitstart = CLOCKCNT;
+		if (remainingblocks > 0)
+		{
+			trstate = 14;  // wait busy, then the next block
+		}
+		else if (stream_open)
+		{
+			card_busy = true;  // checked by the next continue / close
+			FinishTransfer(0);
+		}
+		else if (blockcount > 1)
+		{
+			trstate = 15;  // wait busy, then stop token
+		}
+		else
+		{
+			card_busy = true;  // do not wait the programming time
+			FinishTransfer(0);
+		}
+		break;
+
+	case 14: // wait busy before the next block
+	case 15: // wait busy before the stop token
+		if (SpiXchg(0xFF) != 0xFF)
+		{
+			if (CLOCKCNT - waitstart > SystemCoreClock / 2)  // 500 ms
+			{
+				FinishTransfer(ERROR_TIMEOUT);
+			}
+			return;
+		}
+
+		if (14 == trstate)
+		{
+			trstate = 12; RunTransfer(); return;  // phase jump
+		}
+
+		SpiXchg(SDSPI_TOKEN_STOP_MULTI);
+		card_busy = true;
+		waitstart = CLOCKCNT;
+		FinishTransfer(0);
+		break;
+
+	// open-ended write stream
+
+	case 21: // open stream
+		Select();
+		if (stream_precount)
+		{
+			Command(55, 0);
+			Command(23, (stream_precount & 0x7FFFFF));  // ACMD23: SET_WR_BLK_ERASE_COUNT
+		}
+
+		if (Command(25, addr))
+		{
+			FinishTransfer(ERROR_WRITE);
+			return;
+		}
+		stream_open = true;
+		trstate = 12;
+		break;
+
+	case 31: // continue stream
+		trstate = 12; RunTransfer(); return;  // phase jump
+
+	case 41: // close stream
+		SpiXchg(SDSPI_TOKEN_STOP_MULTI);
+		stream_open = false;
+		card_busy = true;
+		waitstart = CLOCKCNT;
+		FinishTransfer(0);
+		break;
+	}
+}
+
+#endif
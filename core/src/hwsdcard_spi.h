@@ -0,0 +1,92 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwsdcard_spi.h
+ *  brief:    SPI mode SDCARD driver, alternative implementation for the THwSdcard
+ *  version:  1.00
+ *  date:     2021-08-10
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    Activated with "#define HWSDCARD_SPI" in the board.h, then the THwSdcard uses this
+ *    instead of the native SDMMC / HSMCI interface, so the TStorManSdcard works unchanged.
+ *    The native commands of the vendor-independent initialization are translated to SPI mode.
+ *    The spi (initialized, SPI mode 0, DMA channels assigned) and the cspin must be set before Init().
+*/
+
+#ifndef HWSDCARD_SPI_H_
+#define HWSDCARD_SPI_H_
+
+#define HWSDCARD_PRE_ONLY
+#include "hwsdcard.h"
+#include "hwpins.h"
+#include "hwspi.h"
+
+class THwSdcard_spi : public THwSdcard_pre
+{
+public:
+	THwSpi *           spi = nullptr;
+	TGpioPin *         cspin = nullptr;
+
+	bool               crc_enabled = false;  // CRC check on the data blocks (CMD59)
+
+	bool HwInit();
+
+	void SetSpeed(uint32_t speed);
+	void SetBusWidth(uint8_t abuswidth) { }  // always 1 bit
+
+	void SendSpecialCmd(uint32_t aspecialcmd) { }
+	void SendCmd(uint8_t acmd, uint32_t cmdarg, uint32_t cmdflags);
+	bool CmdFinished() { return true; }  // the commands are executed immediately
+
+	void StartDataReadCmd(uint8_t acmd, uint32_t cmdarg, uint32_t cmdflags, void * dataptr, uint32_t datalen);
+	void StartDataWriteCmd(uint8_t acmd, uint32_t cmdarg, uint32_t cmdflags, void * dataptr, uint32_t datalen);
+
+	uint32_t GetCmdResult32() { return cmdresult; }
+	void GetCmdResult128(void * adataptr);
+
+	void RunTransfer();
+
+protected:
+	bool               appcmd_pending = false;
+	uint32_t           cmdresult = 0;
+	uint8_t            regdata[16];   // CID / CSD in SPI byte order
+	uint8_t            crcbuf[2];
+	uint8_t            dummy_tx = 0xFF;
+	uint8_t            dummy_rx = 0;
+	uint32_t           waitstart = 0;
+
+	THwDmaTransfer     txfer;
+	THwDmaTransfer     rxfer;
+
+	void               Select();
+	void               Deselect();
+	uint8_t            SpiXchg(uint8_t adata);
+	uint8_t            Command(uint8_t acmd, uint32_t aarg);
+	bool               ReadDataSync(void * adst, unsigned alen);
+	void               StartBlockDma(bool istx);
+	void               FinishTransfer(int aerror);
+};
+
+#undef  HWSDCARD_IMPL
+#define HWSDCARD_IMPL THwSdcard_spi
+
+#endif // def HWSDCARD_SPI_H_
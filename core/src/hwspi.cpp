@@ -109,3 +109,24 @@ int THwSpi::RunTransfer(TSpiTransfer * axfer)
 
 	return result;
 }
+
+bool THwSpi::ClockChangeBusy()
+{
+	if (!initialized)
+	{
+		return false;
+	}
+	return (!SendFinished() || (txdma && txdma->Active()) || (rxdma && rxdma->Active()));
+}
+
+#ifndef HWSPI_OWN_CLOCKCHANGED
+
+void THwSpi::ClockChanged()
+{
+	if (initialized)
+	{
+		Init(devnum);
+	}
+}
+
+#endif
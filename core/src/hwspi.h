@@ -117,6 +117,11 @@ public:
 
 	inline void     SendData(unsigned short adata) { while (!TrySendData(adata)) {} }; // wait until it successfully started, but does not wait to finish !
 	void            WaitSendFinish();
+
+#ifndef HWSPI_OWN_CLOCKCHANGED  // otherwise the driver has its own
+	void            ClockChanged();  // recalculates the clock divider after a CPU speed change
+#endif
+	bool            ClockChangeBusy();  // transfer or DMA in progress
 };
 
 #endif // ndef HWSPI_H_ */
@@ -80,3 +80,20 @@ bool THwUart::DmaRecvCompleted()
 
 	return true;
 }
+
+bool THwUart::ClockChangeBusy()
+{
+	return initialized && !DmaSendCompleted();  // includes the SendFinished()
+}
+
+#ifndef HWUART_OWN_CLOCKCHANGED
+
+void THwUart::ClockChanged()
+{
+	if (initialized)
+	{
+		Init(devnum);
+	}
+}
+
+#endif
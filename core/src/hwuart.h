@@ -105,6 +105,11 @@ public:
 
 	void printf(const char * fmt, ...);
 	void printf_va(const char * fmt, va_list arglist);
+
+#ifndef HWUART_OWN_CLOCKCHANGED  // otherwise the driver has its own
+	void ClockChanged();  // recalculates the baud rate divider after a CPU speed change
+#endif
+	bool ClockChangeBusy();  // transmission in progress (the circular receive DMA is not checked)
 };
 
 #endif /* HWUART_H_ */
@@ -0,0 +1,198 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     i2cbusman.cpp
+ *  brief:    I2C bus manager: prioritized transaction queue for multiple clients on the same THwI2c
+ *  version:  1.00
+ *  date:     2021-08-08
+ *  authors:  nvitya
+*/
+
+#include "platform.h"
+#include "i2cbusman.h"
+
+bool TI2cBusManager::Init(THwI2c * ai2c)
+{
+	initialized = false;
+
+	i2c = ai2c;
+	if (!i2c || !i2c->initialized)
+	{
+		return false;
+	}
+
+	firsttra = nullptr;
+	curtra = nullptr;
+
+	i2c->completearg = this;
+	i2c->completefunc = I2cCompleteCb;
+
+	initialized = true;
+	return true;
+}
+
+bool TI2cBusManager::AddRead(TI2cBusTrans * atra, TI2cBusClient * aclient, unsigned aextra, void * adst, unsigned alen)
+{
+	atra->client = aclient;
+	atra->iswrite = false;
+	atra->extra = aextra;
+	atra->dataptr = adst;
+	atra->datalen = alen;
+
+	return AddTransaction(atra);
+}
+
+bool TI2cBusManager::AddWrite(TI2cBusTrans * atra, TI2cBusClient * aclient, unsigned aextra, void * asrc, unsigned alen)
+{
+	atra->client = aclient;
+	atra->iswrite = true;
+	atra->extra = aextra;
+	atra->dataptr = asrc;
+	atra->datalen = alen;
+
+	return AddTransaction(atra);
+}
+
+bool TI2cBusManager::AddTransaction(TI2cBusTrans * atra)
+{
+	if (!initialized || !atra->client)
+	{
+		atra->errorcode = ERROR_NOTINIT;
+		atra->completed = true;
+		return false;
+	}
+
+	atra->completed = false;
+	atra->errorcode = 0;
+	atra->next = nullptr;
+
+	uint8_t prio = atra->client->priority;
+
+	// insert after the last transaction with the same or higher priority
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	TI2cBusTrans * prev = nullptr;
+	TI2cBusTrans * tra = firsttra;
+	while (tra && (tra->client->priority >= prio))
+	{
+		prev = tra;
+		tra = tra->next;
+	}
+
+	atra->next = tra;
+	if (prev)  prev->next = atra;
+	else       firsttra = atra;
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+
+	StartNextTra();  // starts only when the bus is idle
+
+	return true;
+}
+
+void TI2cBusManager::WaitTransaction(TI2cBusTrans * atra)
+{
+	while (!atra->completed)
+	{
+		Run();
+	}
+}
+
+void TI2cBusManager::StartNextTra()
+{
+	while (true)
+	{
+		// take the next transaction only when the bus is free, the completion callbacks might have started one
+
+		unsigned pm = __get_PRIMASK();  // save interrupt disable status
+		__disable_irq();
+
+		if (curtra || !firsttra || i2c->busy)
+		{
+			__set_PRIMASK(pm); // restore interrupt disable status
+			return;
+		}
+
+		curtra = firsttra;
+		firsttra = firsttra->next;
+
+		__set_PRIMASK(pm); // restore interrupt disable status
+
+		int err;
+		if (curtra->iswrite)
+		{
+			err = i2c->StartWriteData(curtra->client->address, curtra->extra, curtra->dataptr, curtra->datalen);
+		}
+		else
+		{
+			err = i2c->StartReadData(curtra->client->address, curtra->extra, curtra->dataptr, curtra->datalen);
+		}
+
+		if (ERROR_OK == err)
+		{
+			return;
+		}
+
+		FinishCurTra(err);  // could not be started, the callback might add and start a new one
+	}
+}
+
+void TI2cBusManager::FinishCurTra(int aerror)
+{
+	TI2cBusTrans * tra = curtra;
+	curtra = nullptr;
+
+	// the callback might add the same transaction object again
+	tra->errorcode = aerror;
+	tra->completed = true;
+	if (tra->callback)
+	{
+		(* (tra->callback))(tra->callbackarg);
+	}
+}
+
+void TI2cBusManager::I2cCompleteCb(void * arg)  // called from the THwI2c::Run()
+{
+	TI2cBusManager * pman = (TI2cBusManager *)arg;
+
+	if (pman->curtra)
+	{
+		pman->FinishCurTra(pman->i2c->error);
+	}
+
+	pman->StartNextTra();  // does nothing when the callback has started one already
+}
+
+void TI2cBusManager::Run()
+{
+	if (curtra)
+	{
+		i2c->Run();  // the completion hook starts the next transaction
+		return;
+	}
+
+	if (firsttra && !i2c->busy)
+	{
+		StartNextTra();
+	}
+}
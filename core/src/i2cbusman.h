@@ -0,0 +1,97 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     i2cbusman.h
+ *  brief:    I2C bus manager: prioritized transaction queue for multiple clients on the same THwI2c
+ *  version:  1.00
+ *  date:     2021-08-08
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    The next transaction is started directly from the THwI2c::Run() completion path
+ *    (THwI2c::completefunc), so when the Run() is called from the I2C / DMA IRQ the
+ *    bus does not stay idle between the transactions.
+ *    Higher priority clients are served first, but a running transaction is never interrupted.
+*/
+
+#ifndef I2CBUSMAN_H_
+#define I2CBUSMAN_H_
+
+#include "platform.h"
+#include "hwi2c.h"
+#include "errors.h"
+
+class TI2cBusClient
+{
+public:
+	uint8_t            address = 0;   // 7-bit device address
+	uint8_t            priority = 0;  // higher value = served first
+};
+
+typedef void (* PI2cBusCbFunc)(void * arg);
+
+class TI2cBusTrans
+{
+public:
+	TI2cBusClient *    client = nullptr;
+
+	bool               iswrite = false;
+	unsigned           extra = 0;       // extra (register address) bytes, combined with I2CEX_x
+	void *             dataptr = nullptr;
+	unsigned           datalen = 0;
+
+	volatile bool      completed = true;
+	int                errorcode = 0;
+
+	PI2cBusCbFunc      callback = nullptr;
+	void *             callbackarg = nullptr;
+
+	TI2cBusTrans *     next = nullptr;
+};
+
+class TI2cBusManager
+{
+public:
+	THwI2c *           i2c = nullptr;
+	bool               initialized = false;
+
+	bool               Init(THwI2c * ai2c);
+
+	bool               AddTransaction(TI2cBusTrans * atra);
+	bool               AddRead(TI2cBusTrans * atra, TI2cBusClient * aclient, unsigned aextra, void * adst, unsigned alen);
+	bool               AddWrite(TI2cBusTrans * atra, TI2cBusClient * aclient, unsigned aextra, void * asrc, unsigned alen);
+
+	void               WaitTransaction(TI2cBusTrans * atra); // blocking
+	inline bool        Idle() { return (!curtra && !firsttra); }
+
+	void               Run();
+
+protected:
+	TI2cBusTrans *     firsttra = nullptr;
+	TI2cBusTrans *     curtra = nullptr;
+
+	void               StartNextTra();
+	void               FinishCurTra(int aerror);
+
+	static void        I2cCompleteCb(void * arg);
+};
+
+#endif /* I2CBUSMAN_H_ */
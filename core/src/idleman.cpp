@@ -0,0 +1,162 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     idleman.cpp
+ *  brief:    Tickless low power idle handling
+ *  version:  1.00
+ *  date:     2021-08-14
+ *  authors:  nvitya
+*/
+
+#include "platform.h"
+#include "idleman.h"
+#include "timerwheel.h"
+
+bool TIdleManager::AddDeadlineSource(PIdleDeadlineFunc afunc, void * aarg)
+{
+	if (sourcecount >= IDLEMAN_MAX_SOURCES)
+	{
+		return false;
+	}
+
+	sourcefunc[sourcecount] = afunc;
+	sourcearg[sourcecount] = aarg;
+	++sourcecount;
+	return true;
+}
+
+unsigned TIdleManager::NextDeadline(unsigned aclocks)
+{
+	unsigned result = aclocks;
+
+	for (unsigned n = 0; n < sourcecount; ++n)
+	{
+		unsigned clocks = (*sourcefunc[n])(sourcearg[n]);
+		if (clocks < result)
+		{
+			result = clocks;
+		}
+	}
+
+	if (timerwheel && timerwheel->tick_clocks)
+	{
+		unsigned clocks = timerwheel->ClocksToNext();  // IDLE_NO_DEADLINE when none
+		if (clocks < result)
+		{
+			result = clocks;
+		}
+	}
+
+	return result;
+}
+
+void TIdleManager::Idle(unsigned aclocks)
+{
+	unsigned clocks = NextDeadline(aclocks);
+	if (clocks < sleep_min_clocks)
+	{
+		return;
+	}
+
+	++idle_count;
+
+	if (deepsleep_enabled)
+	{
+		unsigned clocks_per_us = SystemCoreClock / 1000000;
+
+		if (IDLE_NO_DEADLINE == clocks)
+		{
+			// only an external event can wake up
+			hwlowpower.DeepSleep();
+			return;
+		}
+
+		unsigned us = clocks / clocks_per_us;
+		if ((us >= deepsleep_min_us) && TimedDeepSleep(us))
+		{
+			return;
+		}
+	}
+
+	if (IDLE_NO_DEADLINE == clocks)
+	{
+		hwlowpower.Sleep();
+	}
+	else if (use_systick_wakeup)
+	{
+		SysTickSleep(clocks);
+	}
+	// else: no wake up source for the deadline, continue polling
+}
+
+void TIdleManager::SysTickSleep(unsigned aclocks)
+{
+	if (!hwlowpower.SysTickSleep(aclocks, sleep_min_clocks))
+	{
+		return;
+	}
+
+	int late = hwlowpower.systick_late_clocks;  // negative when some other IRQ woke up
+	if (late >= 0)
+	{
+		wakeup_late_clocks = late;
+		if (wakeup_late_clocks > wakeup_late_clocks_max)
+		{
+			wakeup_late_clocks_max = wakeup_late_clocks;
+		}
+	}
+}
+
+bool TIdleManager::TimedDeepSleep(unsigned aus)
+{
+#ifdef CLOCKCNT_WRITABLE
+
+	unsigned clocks_per_us = SystemCoreClock / 1000000;
+
+	// wake up earlier with the clock restore time
+	unsigned restore_us = hwlowpower.wakeup_clocks_max / clocks_per_us;
+	if (aus <= restore_us)
+	{
+		return false;
+	}
+	aus -= restore_us;
+
+	// the CLOCKCNT correction must stay within the half counter range
+	if (aus > 0x7FFFFFFF / clocks_per_us)  aus = 0x7FFFFFFF / clocks_per_us;
+
+	if (!StartWakeupTimer(aus))
+	{
+		return false;
+	}
+
+	hwlowpower.DeepSleep();
+
+	unsigned slept_us = StopWakeupTimer();
+	if (slept_us > 0x7FFFFFFF / clocks_per_us)  slept_us = 0x7FFFFFFF / clocks_per_us;
+
+	CLOCKCNT += slept_us * clocks_per_us;
+
+	return true;
+
+#else
+	return false;  // the CLOCKCNT deadlines would be broken
+#endif
+}
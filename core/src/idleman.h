@@ -0,0 +1,99 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     idleman.h
+ *  brief:    Tickless low power idle handling
+ *  version:  1.00
+ *  date:     2021-08-14
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    The Idle() must be called with disabled interrupts, when there is nothing to do. It collects
+ *    the next deadline from the registered sources (drivers, timer wheel, scheduler) and selects:
+ *      - no sleep: when the deadline is too close
+ *      - sleep (WFI) with SysTick wake up at the deadline: the clocks are kept running
+ *      - deep sleep: when it is enabled, the deadline is far enough, and a low power wake up timer
+ *        is available (or there is no deadline at all)
+ *    The SysTick is used as one-shot timer, its previous state is restored afterwards. A running periodic
+ *    SysTick (pcprof, clockcnt64) wakes up earlier when its tick comes first, and continues with its phase.
+ *    The low power wake up timer comes from the hwlowpower (STM32: LPTIM1), others (RTC etc.) can be
+ *    provided by overriding the StartWakeupTimer() and StopWakeupTimer(). The CLOCKCNT is corrected with
+ *    the slept time afterwards, so the existing deadlines remain valid.
+ *    usage with the scheduler:
+ *
+ *      idleman.AddDeadlineSource(uart_deadline, &uart);
+ *      idleman.timerwheel = &timerwheel;
+ *      sched.idleman = &idleman;
+*/
+
+#ifndef IDLEMAN_H_
+#define IDLEMAN_H_
+
+#include "platform.h"
+#include "clockcnt.h"
+#include "hwlowpower.h"
+
+#ifndef IDLEMAN_MAX_SOURCES
+  #define IDLEMAN_MAX_SOURCES  8
+#endif
+
+#define IDLE_NO_DEADLINE  0xFFFFFFFF
+
+class TTimerWheel;
+
+typedef unsigned (* PIdleDeadlineFunc)(void * arg);  // returns the CPU clocks to the next deadline, IDLE_NO_DEADLINE = none
+
+class TIdleManager
+{
+public:
+	TTimerWheel *       timerwheel = nullptr;        // optional deadline source
+
+	bool                use_systick_wakeup = true;
+	bool                deepsleep_enabled = false;
+	unsigned            sleep_min_clocks = 2000;     // below this do not go to sleep
+	unsigned            deepsleep_min_us = 2000;     // minimal idle time for the deep sleep
+
+	// statistics
+	unsigned            idle_count = 0;
+	unsigned            wakeup_late_clocks = 0;      // SysTick wake up latency: from the deadline to running
+	unsigned            wakeup_late_clocks_max = 0;
+
+	virtual             ~TIdleManager() { }
+
+	bool                AddDeadlineSource(PIdleDeadlineFunc afunc, void * aarg);
+
+	unsigned            NextDeadline(unsigned aclocks);  // aclocks = deadline from the caller
+	void                Idle(unsigned aclocks);
+
+public: // low power wake up timer for the deep sleep
+	virtual bool        StartWakeupTimer(unsigned aus)  { return hwlowpower.StartWakeupTimer(aus); }  // false = not available
+	virtual unsigned    StopWakeupTimer()               { return hwlowpower.StopWakeupTimer(); }      // returns the slept time in us
+
+protected:
+	unsigned            sourcecount = 0;
+	PIdleDeadlineFunc   sourcefunc[IDLEMAN_MAX_SOURCES];
+	void *              sourcearg[IDLEMAN_MAX_SOURCES];
+
+	void                SysTickSleep(unsigned aclocks);
+	bool                TimedDeepSleep(unsigned aus);
+};
+
+#endif /* IDLEMAN_H_ */
@@ -84,4 +84,36 @@ inline void __attribute__((always_inline)) mcu_disable_dcache()
 	#endif
 }
 
+// D-Cache range maintenance for the DMA buffers, nothing happens when the D-Cache is not present or not enabled
+
+inline void __attribute__((always_inline)) mcu_dcache_clean(void * aaddr, unsigned alen)
+{
+	#if __DCACHE_PRESENT
+		if (SCB->CCR & SCB_CCR_DC_Msk)
+		{
+			SCB_CleanDCache_by_Addr((uint32_t *)aaddr, alen);  // write back the CPU written data before the DMA reads it
+		}
+	#endif
+}
+
+inline void __attribute__((always_inline)) mcu_dcache_invalidate(void * aaddr, unsigned alen)
+{
+	#if __DCACHE_PRESENT
+		if (SCB->CCR & SCB_CCR_DC_Msk)
+		{
+			SCB_InvalidateDCache_by_Addr(aaddr, alen);  // drop the cached lines after the DMA wrote the memory
+		}
+	#endif
+}
+
+inline void __attribute__((always_inline)) mcu_dcache_clean_invalidate(void * aaddr, unsigned alen)
+{
+	#if __DCACHE_PRESENT
+		if (SCB->CCR & SCB_CCR_DC_Msk)
+		{
+			SCB_CleanInvalidateDCache_by_Addr((uint32_t *)aaddr, alen);
+		}
+	#endif
+}
+
 #endif /* MCU_GENERIC_FUNCTIONS_H_ */
@@ -0,0 +1,198 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     mpuconfig.cpp
+ *  brief:    Cortex-M3/M4/M7 MPU region configuration with memory attribute table
+ *  version:  1.00
+ *  date:     2021-08-12
+ *  authors:  nvitya
+*/
+
+#include "platform.h"
+#include "mpuconfig.h"
+
+extern unsigned __Main_Stack_Limit;  // defined in the linker script
+
+#if MPU_IMPLEMENTED
+
+unsigned mpu_region_count()
+{
+	return ((MPU->TYPE & MPU_TYPE_DREGION_Msk) >> MPU_TYPE_DREGION_Pos);
+}
+
+static uint32_t mpu_access_attr(unsigned aattr)
+{
+	unsigned shareable = ((aattr & MPUF_SHAREABLE) ? 1 : 0);
+
+	switch (aattr & MPUATTR_TYPE_MASK)
+	{
+		case MPUATTR_STRONGLY_ORDERED:  return ARM_MPU_ACCESS_ORDERED;
+		case MPUATTR_DEVICE:            return ARM_MPU_ACCESS_DEVICE(shareable);
+		case MPUATTR_WRITE_THROUGH:     return ARM_MPU_ACCESS_NORMAL(ARM_MPU_CACHEP_WT_NWA,  ARM_MPU_CACHEP_WT_NWA,  shareable);
+		case MPUATTR_WRITE_BACK:        return ARM_MPU_ACCESS_NORMAL(ARM_MPU_CACHEP_WB_WRA,  ARM_MPU_CACHEP_WB_WRA,  shareable);
+		case MPUATTR_WRITE_BACK_NWA:    return ARM_MPU_ACCESS_NORMAL(ARM_MPU_CACHEP_WB_NWA,  ARM_MPU_CACHEP_WB_NWA,  shareable);
+		default:                        return ARM_MPU_ACCESS_NORMAL(ARM_MPU_CACHEP_NOCACHE, ARM_MPU_CACHEP_NOCACHE, shareable);
+	}
+}
+
+bool mpu_set_region(unsigned aregnum, const TMpuRegion * aregion)
+{
+	if ((aregnum >= mpu_region_count()) || (aregion->size < 32))
+	{
+		return false;
+	}
+
+	// search the smallest power of 2 region which covers the range with sub-region granularity
+
+	uint64_t rstart = aregion->address;
+	uint64_t rend = rstart + aregion->size;
+	uint64_t base = 0;
+	unsigned srd = 0;
+	unsigned sizecode; // region size = 2^(sizecode + 1)
+
+	for (sizecode = 4; sizecode <= 31; ++sizecode)
+	{
+		uint64_t rsize = (uint64_t(1) << (sizecode + 1));
+		base = (rstart & ~(rsize - 1));
+		if (rend > base + rsize)
+		{
+			continue;
+		}
+
+		if ((base == rstart) && (rend == base + rsize))
+		{
+			break;  // exact fit
+		}
+
+		if (rsize < 256)
+		{
+			continue;  // sub-regions are supported only from 256 bytes
+		}
+
+		uint64_t subsize = (rsize >> 3);
+		if (((rstart - base) & (subsize - 1)) || ((rend - base) & (subsize - 1)))
+		{
+			continue;
+		}
+
+		// disable the sub-regions outside of the range
+		for (unsigned n = 0; n < 8; ++n)
+		{
+			uint64_t substart = base + n * subsize;
+			if ((substart < rstart) || (substart >= rend))
+			{
+				srd |= (1 << n);
+			}
+		}
+		break;
+	}
+
+	if (sizecode > 31)
+	{
+		return false;  // the range can not be represented
+	}
+
+	uint32_t ap = ARM_MPU_AP_FULL;
+	if (aregion->attr & MPUF_NOACCESS)  ap = ARM_MPU_AP_NONE;
+	else if (aregion->attr & MPUF_RO)   ap = ARM_MPU_AP_RO;
+
+	__DMB();
+	ARM_MPU_SetRegionEx(aregnum, ARM_MPU_RBAR(aregnum, uint32_t(base)),
+			ARM_MPU_RASR_EX(((aregion->attr & MPUF_XN) ? 1 : 0), ap, mpu_access_attr(aregion->attr), srd, sizecode));
+	__DSB();
+	__ISB();
+
+	return true;
+}
+
+void mpu_clear_region(unsigned aregnum)
+{
+	if (aregnum < mpu_region_count())
+	{
+		ARM_MPU_ClrRegion(aregnum);
+	}
+}
+
+unsigned mpu_setup(const TMpuRegion * atable, unsigned acount)
+{
+	unsigned result = 0;
+	unsigned regcnt = mpu_region_count();
+	for (unsigned n = 0; n < regcnt; ++n)
+	{
+		if (n < acount)
+		{
+			if (mpu_set_region(n, &atable[n]))
+			{
+				++result;
+			}
+			else
+			{
+				ARM_MPU_ClrRegion(n);
+			}
+		}
+		else
+		{
+			ARM_MPU_ClrRegion(n);
+		}
+	}
+
+	return result;
+}
+
+bool mpu_stack_guard(unsigned asize)
+{
+	unsigned regcnt = mpu_region_count();
+	if (!regcnt)
+	{
+		return false;
+	}
+
+	// the guard is placed into the bottom of the stack area, so it does not overlap with the heap
+	TMpuRegion guard;
+	guard.name = "stack guard";
+	guard.address = ((unsigned(&__Main_Stack_Limit) + asize - 1) & ~(asize - 1));
+	guard.size = asize;
+	guard.attr = MPUATTR_NONCACHEABLE | MPUF_XN | MPUF_NOACCESS;
+
+	return mpu_set_region(regcnt - 1, &guard);
+}
+
+void mpu_enable()
+{
+	ARM_MPU_Enable(MPU_CTRL_PRIVDEFENA_Msk);
+}
+
+void mpu_disable()
+{
+	ARM_MPU_Disable();
+}
+
+#else
+
+unsigned mpu_region_count()                                     { return 0; }
+bool mpu_set_region(unsigned aregnum, const TMpuRegion * aregion) { return false; }
+void mpu_clear_region(unsigned aregnum)                         { }
+unsigned mpu_setup(const TMpuRegion * atable, unsigned acount)  { return 0; }
+bool mpu_stack_guard(unsigned asize)                            { return false; }
+void mpu_enable()                                               { }
+void mpu_disable()                                              { }
+
+#endif
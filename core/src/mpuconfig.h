@@ -0,0 +1,101 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     mpuconfig.h
+ *  brief:    Cortex-M3/M4/M7 MPU region configuration with memory attribute table
+ *  version:  1.00
+ *  date:     2021-08-12
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    usage example (at the beginning of the main, before the caches are enabled):
+ *
+ *      const TMpuRegion mpu_regions[] =
+ *      {
+ *        { "SDRAM framebuffer", 0xC0000000, 0x00800000, MPUATTR_WRITE_THROUGH },
+ *        { "DMA pool",          (unsigned)&dma_pool[0], sizeof(dma_pool), MPUATTR_NONCACHEABLE },
+ *        { "QSPI XIP",          0x90000000, 0x01000000, MPUATTR_WRITE_BACK | MPUF_RO },
+ *      };
+ *
+ *      mpu_setup(&mpu_regions[0], sizeof(mpu_regions) / sizeof(TMpuRegion));
+ *      mpu_stack_guard();
+ *      mpu_enable();
+ *
+ *    The regions with higher index have priority on overlaps, the stack guard uses the last one.
+ *    Because of the ARMv7-M restrictions the regions are placed on power of 2 boundaries, the
+ *    unaligned address ranges are trimmed with the sub-region disable bits, so the start and the end
+ *    of the range must be aligned at least to 1/8 of the covering region size.
+*/
+
+#ifndef MPUCONFIG_H_
+#define MPUCONFIG_H_
+
+#include "platform.h"
+
+// memory types (low byte)
+
+#define MPUATTR_STRONGLY_ORDERED   0x01
+#define MPUATTR_DEVICE             0x02
+#define MPUATTR_NONCACHEABLE       0x03  // normal memory, not cached
+#define MPUATTR_WRITE_THROUGH      0x04  // normal memory, write-through, no write allocate
+#define MPUATTR_WRITE_BACK         0x05  // normal memory, write-back, read and write allocate
+#define MPUATTR_WRITE_BACK_NWA     0x06  // normal memory, write-back, no write allocate
+
+#define MPUATTR_TYPE_MASK          0xFF
+
+// flags
+
+#define MPUF_XN                    0x0100  // execute never
+#define MPUF_SHAREABLE             0x0200  // the D-Cache of the Cortex-M7 treats shareable regions as non-cacheable !
+#define MPUF_RO                    0x0400  // read only
+#define MPUF_NOACCESS              0x0800  // any access generates MemManage fault (guard regions)
+
+class TMpuRegion
+{
+public:
+	const char *   name;     // only for the diagnostics
+	unsigned       address;
+	unsigned       size;     // in bytes
+	unsigned       attr;     // MPUATTR_* | MPUF_*
+};
+
+#if defined(__MPU_PRESENT) && __MPU_PRESENT && (__CORTEX_M >= 3)
+  #define MPU_IMPLEMENTED  1
+#else
+  #define MPU_IMPLEMENTED  0
+#endif
+
+unsigned mpu_region_count();  // 0 when not implemented
+
+bool mpu_set_region(unsigned aregnum, const TMpuRegion * aregion);
+void mpu_clear_region(unsigned aregnum);
+
+// sets the regions from 0, returns the number of the successfully configured regions
+unsigned mpu_setup(const TMpuRegion * atable, unsigned acount);
+
+// No access region at the bottom of the main stack (__Main_Stack_Limit from the linker script), uses the last region
+bool mpu_stack_guard(unsigned asize = 32);
+
+// the default memory map remains valid for the privileged code outside of the defined regions
+void mpu_enable();
+void mpu_disable();
+
+#endif /* MPUCONFIG_H_ */
@@ -0,0 +1,225 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     objpool.h
+ *  brief:    Fixed size object pool with compile-time capacity
+ *  version:  1.00
+ *  date:     2021-08-12
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    The allocation and release are O(1) and interrupt safe. On Cortex-M3 and above the free list is
+ *    lock-free (LDREX / STREX), on Cortex-M0 short interrupt disabled sections are used.
+ *    usage:
+ *
+ *      TObjectPool<TStorTrans, 8>  trapool;
+ *
+ *      TStorTrans * ptra = trapool.New();
+ *      ...
+ *      trapool.Delete(ptra);
+ *
+ *    The type independent TObjectPoolBase can be passed to the other layers (e.g. TFileSystem::filepool).
+*/
+
+#ifndef OBJPOOL_H_
+#define OBJPOOL_H_
+
+#include "platform.h"
+#include <new>
+#include <utility>
+
+#define OBJPOOL_EMPTY  0xFFFF
+
+class TObjectPoolBase
+{
+public:
+	unsigned            objsize = 0;    // size of one slot
+	unsigned            capacity = 0;
+
+	volatile unsigned   usedcount = 0;
+	volatile unsigned   peakcount = 0;  // high-water mark
+	volatile unsigned   failcount = 0;
+
+	void * AllocRaw()
+	{
+		unsigned idx;
+
+#if __CORTEX_M >= 3
+		uint32_t oldhead;
+		do
+		{
+			oldhead = __LDREXW((uint32_t *)&freehead);
+			idx = (oldhead & 0xFFFF);
+			if (OBJPOOL_EMPTY == idx)
+			{
+				__CLREX();
+				break;
+			}
+			// the upper 16 bits are incremented at every change against the ABA problem
+		}
+		while (__STREXW(((oldhead + 0x10000) & 0xFFFF0000) | nextidx[idx], (uint32_t *)&freehead));
+#else
+		unsigned pm = __get_PRIMASK();  // save interrupt disable status
+		__disable_irq();
+		idx = (freehead & 0xFFFF);
+		if (OBJPOOL_EMPTY != idx)
+		{
+			freehead = nextidx[idx];
+		}
+	 	__set_PRIMASK(pm); // restore interrupt disable status
+#endif
+
+		if (OBJPOOL_EMPTY == idx)
+		{
+			AtomicAdd(&failcount, 1);
+			return nullptr;
+		}
+
+		unsigned cnt = AtomicAdd(&usedcount, 1);
+		while (cnt > peakcount)  // might be interrupted
+		{
+			peakcount = cnt;
+		}
+
+		return slots + idx * objsize;
+	}
+
+	void FreeRaw(void * aobj)
+	{
+		if (!Contains(aobj))
+		{
+			return;
+		}
+
+		unsigned idx = ((uint8_t *)aobj - slots) / objsize;
+
+#if __CORTEX_M >= 3
+		uint32_t oldhead;
+		do
+		{
+			oldhead = __LDREXW((uint32_t *)&freehead);
+			nextidx[idx] = (oldhead & 0xFFFF);
+		}
+		while (__STREXW(((oldhead + 0x10000) & 0xFFFF0000) | idx, (uint32_t *)&freehead));
+#else
+		unsigned pm = __get_PRIMASK();  // save interrupt disable status
+		__disable_irq();
+		nextidx[idx] = freehead;
+		freehead = idx;
+	 	__set_PRIMASK(pm); // restore interrupt disable status
+#endif
+
+		AtomicAdd(&usedcount, -1);
+	}
+
+	inline bool Contains(void * aobj)
+	{
+		return ((uint8_t *)aobj >= slots) && ((uint8_t *)aobj < slots + capacity * objsize);
+	}
+
+	inline unsigned FreeCount() { return capacity - usedcount; }
+
+protected:
+	volatile uint32_t   freehead = OBJPOOL_EMPTY;  // low 16 bit: first free index, high 16 bit: change counter
+	uint8_t *           slots = nullptr;
+	uint16_t *          nextidx = nullptr;
+
+	void InitPool(uint8_t * aslots, uint16_t * anextidx, unsigned aobjsize, unsigned acapacity)
+	{
+		slots = aslots;
+		nextidx = anextidx;
+		objsize = aobjsize;
+		capacity = acapacity;
+
+		for (unsigned n = 0; n < capacity; ++n)
+		{
+			nextidx[n] = ((n + 1 < capacity) ? n + 1 : OBJPOOL_EMPTY);
+		}
+		freehead = (capacity ? 0 : OBJPOOL_EMPTY);
+	}
+
+	static unsigned AtomicAdd(volatile unsigned * avar, int aincr)  // returns the new value
+	{
+		unsigned result;
+#if __CORTEX_M >= 3
+		do
+		{
+			result = __LDREXW((uint32_t *)avar) + aincr;
+		}
+		while (__STREXW(result, (uint32_t *)avar));
+#else
+		unsigned pm = __get_PRIMASK();  // save interrupt disable status
+		__disable_irq();
+		result = *avar + aincr;
+		*avar = result;
+	 	__set_PRIMASK(pm); // restore interrupt disable status
+#endif
+		return result;
+	}
+};
+
+template <class T, unsigned N>
+class TObjectPool : public TObjectPoolBase
+{
+	static_assert((N > 0) && (N < OBJPOOL_EMPTY), "Invalid object pool capacity");
+
+public:
+	TObjectPool()
+	{
+		InitPool(&storage[0].data[0], &links[0], sizeof(TSlot), N);
+	}
+
+	inline T * Alloc() // without construction
+	{
+		return (T *)AllocRaw();
+	}
+
+	template <typename... Args>
+	T * New(Args&&... args)
+	{
+		void * p = AllocRaw();
+		if (!p)
+		{
+			return nullptr;
+		}
+		return new (p) T(std::forward<Args>(args)...);
+	}
+
+	void Delete(T * aobj)
+	{
+		if (aobj)
+		{
+			aobj->~T();
+			FreeRaw(aobj);
+		}
+	}
+
+protected:
+	union TSlot
+	{
+		alignas(T) uint8_t  data[sizeof(T)];
+	};
+
+	TSlot               storage[N];
+	uint16_t            links[N];
+};
+
+#endif /* OBJPOOL_H_ */
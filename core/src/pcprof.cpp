@@ -0,0 +1,257 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     pcprof.cpp
+ *  brief:    Statistical PC sampling profiler (DWT PC sampling or SysTick sampler)
+ *  version:  1.00
+ *  date:     2021-08-02
+ *  authors:  nvitya
+*/
+
+#include "platform.h"
+#include "pcprof.h"
+
+// some Atmel devices use this name
+#ifdef PORT
+  #undef PORT
+#endif
+
+TPcProfiler  pcprof;
+
+bool TPcProfiler::Init(uint8_t amode, uint8_t aoutput, unsigned asample_khz)
+{
+	initialized = false;
+
+	Stop();
+
+	mode = amode;
+	output = aoutput;
+
+	if (asample_khz < 1)  asample_khz = 1;
+	unsigned clocks = SystemCoreClock / (asample_khz * 1000);
+
+	if (PCPROF_MODE_DWT == mode)
+	{
+#if __CORTEX_M >= 3
+		if (PCPROF_OUT_SWO != output)
+		{
+			return false; // the DWT packets go always to the SWO
+		}
+
+		// sampling period = (POSTPRESET + 1) * 64 or 1024 (CYCTAP) CPU clocks
+		unsigned cyctap = 0;
+		unsigned tapclocks = 64;
+		if (clocks > 16 * 64)
+		{
+			cyctap = 1;
+			tapclocks = 1024;
+		}
+
+		unsigned postpreset = clocks / tapclocks;
+		if (postpreset > 0)   --postpreset;
+		if (postpreset > 15)  postpreset = 15;
+
+		dwt_ctrl_bits = 0
+			| (cyctap << DWT_CTRL_CYCTAP_Pos)
+			| (postpreset << DWT_CTRL_POSTINIT_Pos)
+			| (postpreset << DWT_CTRL_POSTPRESET_Pos)
+		;
+
+		sample_rate = SystemCoreClock / ((postpreset + 1) * tapclocks);
+#else
+		return false;  // no DWT PC sampling on Cortex-M0
+#endif
+	}
+	else if (PCPROF_MODE_SYSTICK == mode)
+	{
+#if PCPROF_SYSTICK_HANDLER
+  #if __CORTEX_M < 3
+		if (PCPROF_OUT_SWO == output)
+		{
+			return false; // no ITM on Cortex-M0
+		}
+  #endif
+		if (clocks > 0x01000000)  clocks = 0x01000000;  // 24 bit counter
+		if (clocks < 256)         clocks = 256; // leave some time for the application
+		systick_reload = clocks - 1;
+
+		sample_rate = SystemCoreClock / clocks;
+#else
+		return false;  // define PCPROF_SYSTICK_HANDLER = 1 in the board.h
+#endif
+	}
+	else
+	{
+		return false;
+	}
+
+	Reset();
+
+	initialized = true;
+	return true;
+}
+
+void TPcProfiler::SetBuffer(uint32_t * abuf, unsigned abufsize)
+{
+	Stop();
+
+	buf = abuf;
+	bufsize = (abuf ? abufsize : 0);
+
+	Reset();
+}
+
+void TPcProfiler::Reset()
+{
+	sample_count = 0;
+	dropped_count = 0;
+}
+
+void TPcProfiler::Start()
+{
+	if (!initialized)
+	{
+		return;
+	}
+
+#if __CORTEX_M >= 3
+	if (PCPROF_OUT_SWO == output)
+	{
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		ITM->TER |= (1 << PCPROF_ITM_PORT);
+	}
+
+	if (PCPROF_MODE_DWT == mode)
+	{
+		ITM->TCR |= ITM_TCR_DWTENA_Msk;  // forward the DWT packets
+
+		// the counter settings must be changed only when the sampling is disabled
+		uint32_t ctrl = DWT->CTRL & ~(DWT_CTRL_PCSAMPLENA_Msk | DWT_CTRL_CYCTAP_Msk | DWT_CTRL_POSTINIT_Msk | DWT_CTRL_POSTPRESET_Msk);
+		ctrl |= (dwt_ctrl_bits | DWT_CTRL_CYCCNTENA_Msk);  // the CLOCKCNT must run
+		DWT->CTRL = ctrl;
+		DWT->CTRL = ctrl | DWT_CTRL_PCSAMPLENA_Msk;
+	}
+#endif
+
+	if (PCPROF_MODE_SYSTICK == mode)
+	{
+		if (SysTick->CTRL & SysTick_CTRL_ENABLE_Msk)
+		{
+			// already used by the application (with IRQ), sample with its period
+			sample_rate = SystemCoreClock / (SysTick->LOAD + 1);
+			systick_owned = false;
+		}
+		else
+		{
+			SysTick->LOAD = systick_reload;
+			SysTick->VAL  = 0;
+			SysTick->CTRL = (SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk);
+			systick_owned = true;
+		}
+	}
+
+	running = true;
+}
+
+void TPcProfiler::Stop()
+{
+	if (!running)
+	{
+		return;
+	}
+
+#if __CORTEX_M >= 3
+	if (PCPROF_MODE_DWT == mode)
+	{
+		DWT->CTRL &= ~DWT_CTRL_PCSAMPLENA_Msk;
+	}
+#endif
+
+	if ((PCPROF_MODE_SYSTICK == mode) && systick_owned)
+	{
+		SysTick->CTRL = 0;
+		systick_owned = false;
+	}
+
+	running = false;
+}
+
+void TPcProfiler::RecordSample(uint32_t apc)
+{
+#if __CORTEX_M >= 3
+	if (PCPROF_OUT_SWO == output)
+	{
+		if (ITM->PORT[PCPROF_ITM_PORT].u32)
+		{
+			ITM->PORT[PCPROF_ITM_PORT].u32 = apc;
+			++sample_count;
+		}
+		else
+		{
+			++dropped_count;
+		}
+		return;
+	}
+#endif
+
+	if (sample_count < bufsize)
+	{
+		buf[sample_count] = apc;
+		++sample_count;
+	}
+	else
+	{
+		++dropped_count;
+	}
+}
+
+extern "C" void pcprof_record_sample(uint32_t apc)
+{
+	pcprof.RecordSample(apc);
+}
+
+#if PCPROF_SYSTICK_HANDLER
+
+// Reads the stacked PC from the exception frame (MSP or PSP, selected by the EXC_RETURN)
+// and tail calls the pcprof_record_sample() with it. Thumb-1 code, so it works on Cortex-M0 too.
+
+extern "C" void __attribute__((naked)) SysTick_Handler()
+{
+	asm volatile (
+		"movs  r0, #4                   \n"
+		"mov   r1, lr                   \n"
+		"tst   r0, r1                   \n"
+		"beq   1f                       \n"
+		"mrs   r0, psp                  \n"
+		"b     2f                       \n"
+	"1:                               \n"
+		"mrs   r0, msp                  \n"
+	"2:                               \n"
+		"ldr   r0, [r0, #24]            \n"  // stacked PC
+		"ldr   r1, =pcprof_record_sample \n"
+		"bx    r1                       \n"
+		".ltorg                         \n"
+	);
+}
+
+#endif
+
+//--- End Of file --------------------------------------------------------------
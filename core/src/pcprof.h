@@ -0,0 +1,98 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     pcprof.h
+ *  brief:    Statistical PC sampling profiler (DWT PC sampling or SysTick sampler)
+ *  version:  1.00
+ *  date:     2021-08-02
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    PCPROF_MODE_DWT:
+ *      the DWT generates hardware PC sample packets into the ITM / SWO stream, no CPU load at all.
+ *      Only from Cortex-M3, the SWO (TPIU) must be configured by the debugger (like for the swo_printf)
+ *
+ *    PCPROF_MODE_SYSTICK:
+ *      the SysTick IRQ records the stacked PC into a RAM buffer or to an ITM stimulus port.
+ *      Works on Cortex-M0 too (only with the RAM output). The profiler needs the SysTick_Handler,
+ *      so define PCPROF_SYSTICK_HANDLER = 1 in the board.h to enable this mode.
+ *      When the SysTick is already running, the profiler samples with its period and does not
+ *      reprogram it. The SysTick IRQ priority is not changed, set it to the highest (0) to
+ *      sample the other IRQ handlers too.
+ *
+ *    The samples can be evaluated with the tools/pcprof.py host script using the ELF file.
+*/
+
+#ifndef __PCPROF_H
+#define __PCPROF_H
+
+#include "platform.h"
+
+#define PCPROF_MODE_DWT       1
+#define PCPROF_MODE_SYSTICK   2
+
+#define PCPROF_OUT_SWO        1  // ITM stimulus port (SysTick mode) or DWT hardware packets
+#define PCPROF_OUT_RAM        2  // RAM buffer, SysTick mode only
+
+#ifndef PCPROF_ITM_PORT
+  #define PCPROF_ITM_PORT     1  // the port 0 is used by the swo_printf()
+#endif
+
+#ifndef PCPROF_SYSTICK_HANDLER
+  #define PCPROF_SYSTICK_HANDLER  0  // 1 = the profiler defines the SysTick_Handler
+#endif
+
+class TPcProfiler
+{
+public:
+	bool               initialized = false;
+	bool               running = false;
+
+	uint8_t            mode = 0;
+	uint8_t            output = 0;
+	unsigned           sample_rate = 0;   // the real sampling rate in Hz (after rounding)
+
+	uint32_t *         buf = nullptr;     // RAM output buffer
+	unsigned           bufsize = 0;       // in samples
+
+	volatile unsigned  sample_count = 0;  // recorded samples, for the RAM output the valid buffer entries
+	volatile unsigned  dropped_count = 0; // ITM FIFO full or RAM buffer full
+
+	bool               Init(uint8_t amode, uint8_t aoutput, unsigned asample_khz);
+	void               SetBuffer(uint32_t * abuf, unsigned abufsize);
+
+	void               Start();
+	void               Stop();
+	void               Reset();  // clears the collected samples
+
+	void               RecordSample(uint32_t apc);  // called from the sampling IRQ
+
+protected:
+	uint32_t           dwt_ctrl_bits = 0;
+	uint32_t           systick_reload = 0;
+	bool               systick_owned = false;  // the SysTick was started by the profiler
+};
+
+extern TPcProfiler  pcprof;
+
+#endif
+
+//--- End Of file --------------------------------------------------------------
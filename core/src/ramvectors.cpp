@@ -0,0 +1,132 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     ramvectors.cpp
+ *  brief:    RAM vector table with run-time handler and member function attach
+ *  version:  1.00
+ *  date:     2021-08-12
+ *  authors:  nvitya
+*/
+
+#include "platform.h"
+#include "ramvectors.h"
+
+// the VTOR requires alignment to the table size rounded up to power of two
+static_assert(RAMVECTORS_COUNT <= 256, "RAM vector table alignment too small");
+
+__attribute__ ((section(".bss_DTCRAM"),aligned(1024)))
+PIrqHandler  ramvectors_table[RAMVECTORS_COUNT];
+
+// the thunks are executed, so they must be in a code capable RAM (the DTCRAM is not on Cortex-M7)
+__attribute__ ((section(".bss_ITCRAM"),aligned(4)))
+TIrqThunk    ramvectors_thunks[MAX_IRQ_HANDLER_COUNT];
+
+static_assert(sizeof(TIrqThunk) == 16, "Invalid IRQ thunk layout");
+
+#if (__CORTEX_M >= 3) || __VTOR_PRESENT
+
+bool ramvectors_init()
+{
+	if (SCB->VTOR == (unsigned)&ramvectors_table[0])
+	{
+		return true; // already initialized
+	}
+
+	for (unsigned n = 0; n < RAMVECTORS_COUNT; ++n)
+	{
+		ramvectors_table[n] = __isr_vectors[n];
+	}
+
+	for (unsigned n = 0; n < MAX_IRQ_HANDLER_COUNT; ++n)
+	{
+		TIrqThunk * pthunk = &ramvectors_thunks[n];
+		pthunk->code[0] = 0x4801;  // ldr r0, [pc, #4]  (obj)
+		pthunk->code[1] = 0x4902;  // ldr r1, [pc, #8]  (func)
+		pthunk->code[2] = 0x4708;  // bx  r1
+		pthunk->code[3] = 0x46C0;  // nop (mov r8, r8)
+		pthunk->obj = nullptr;
+		pthunk->func = nullptr;
+	}
+
+	// the thunk code must reach the memory and the instruction fetch
+	mcu_dcache_clean(&ramvectors_thunks[0], sizeof(ramvectors_thunks));
+	__DSB();
+#if __ICACHE_PRESENT
+	SCB_InvalidateICache();
+#endif
+	__ISB();
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	__DSB();
+	SCB->VTOR = (unsigned)&ramvectors_table[0];
+	__DSB();
+	__ISB();
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+
+	return true;
+}
+
+bool ramvectors_set_handler(int airqnum, PIrqHandler ahandler)
+{
+	if ((airqnum < -15) || (airqnum >= MAX_IRQ_HANDLER_COUNT) || (SCB->VTOR != (unsigned)&ramvectors_table[0]))
+	{
+		return false;
+	}
+
+	ramvectors_table[16 + airqnum] = ahandler;
+	__DSB();
+
+	return true;
+}
+
+bool ramvectors_attach_func(int airqnum, PIrqObjFunc afunc, void * aobj)
+{
+	if ((airqnum < 0) || (airqnum >= MAX_IRQ_HANDLER_COUNT))
+	{
+		return false;
+	}
+
+	TIrqThunk * pthunk = &ramvectors_thunks[airqnum];
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	// only the literal data changes, the code is written once by the ramvectors_init()
+	pthunk->func = afunc;
+	pthunk->obj = aobj;
+	mcu_dcache_clean(pthunk, sizeof(TIrqThunk));
+	bool result = ramvectors_set_handler(airqnum, (PIrqHandler)((unsigned)pthunk | 1));  // thumb
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+
+	return result;
+}
+
+#else
+
+bool ramvectors_init()                                                { return false; }
+bool ramvectors_set_handler(int airqnum, PIrqHandler ahandler)        { return false; }
+bool ramvectors_attach_func(int airqnum, PIrqObjFunc afunc, void * aobj) { return false; }
+
+#endif
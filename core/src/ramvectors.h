@@ -0,0 +1,84 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     ramvectors.h
+ *  brief:    RAM vector table with run-time handler and member function attach
+ *  version:  1.00
+ *  date:     2021-08-12
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    The ramvectors_init() copies the flash vector table into the DTCRAM (aliased to RAM where not present)
+ *    and sets the VTOR. The MCUs without VTOR (Cortex-M0) are not supported.
+ *    usage:
+ *
+ *      ramvectors_init();
+ *      ramvectors_attach<THwCan, &THwCan::HandleIrq>(CAN1_RX0_IRQn, &can);  // object + member function
+ *      ramvectors_set_handler(TIM2_IRQn, my_tim2_handler);                   // plain function, no overhead
+ *
+ *    The attach puts a small code thunk (in the ITCRAM) directly into the vector slot, which loads the
+ *    object pointer into r0 and jumps to the member function thunk. So there is no common dispatcher,
+ *    only this extra branch.
+*/
+
+#ifndef RAMVECTORS_H_
+#define RAMVECTORS_H_
+
+#include "platform.h"
+
+typedef void (* PIrqHandler)(void);
+typedef void (* PIrqObjFunc)(void * aobj);
+
+class TIrqThunk  // executable code, the layout is fixed
+{
+public:
+	uint16_t       code[4];  // ldr r0, [pc, #4]; ldr r1, [pc, #8]; bx r1; nop
+	void *         obj;
+	PIrqObjFunc    func;
+};
+
+#define RAMVECTORS_COUNT  (16 + MAX_IRQ_HANDLER_COUNT)
+
+extern PIrqHandler  ramvectors_table[RAMVECTORS_COUNT];
+extern TIrqThunk    ramvectors_thunks[MAX_IRQ_HANDLER_COUNT];
+
+bool ramvectors_init();  // returns false when the vector table can not be relocated
+
+// airqnum: the CMSIS IRQn number (0 = first peripheral IRQ, the negative ones are the system exceptions, min. -15)
+bool ramvectors_set_handler(int airqnum, PIrqHandler ahandler);
+
+bool ramvectors_attach_func(int airqnum, PIrqObjFunc afunc, void * aobj);  // peripheral IRQs only
+
+// the member function is called directly from the (template generated) thunk, without virtual or instance table lookup
+
+template <class T, void (T::*F)()>
+void ramvectors_member_thunk(void * aobj)
+{
+	(static_cast<T *>(aobj)->*F)();
+}
+
+template <class T, void (T::*F)()>
+inline bool ramvectors_attach(int airqnum, T * aobj)
+{
+	return ramvectors_attach_func(airqnum, ramvectors_member_thunk<T, F>, aobj);
+}
+
+#endif /* RAMVECTORS_H_ */
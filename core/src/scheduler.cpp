@@ -0,0 +1,267 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     scheduler.cpp
+ *  brief:    Event-driven cooperative scheduler for the Run() state machines
+ *  version:  1.00
+ *  date:     2021-08-05
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    the deadlines must be within 2^31 CPU clocks
+ *    with the CLOCKCNT16 emulation (Cortex-M0) do not let the CPU sleep longer than the 16 bit timer period
+*/
+
+#include "platform.h"
+#include "scheduler.h"
+#include "idleman.h"
+
+//-----------------------------------------------------------------------------
+// TSchedTask
+//-----------------------------------------------------------------------------
+
+void TSchedTask::SleepUntil(clockcnt_t adeadline)
+{
+	deadline = adeadline;
+	deadline_active = true;
+}
+
+void TSchedTask::SleepClocks(unsigned aclocks)
+{
+	SleepUntil(CLOCKCNT + aclocks);
+}
+
+void TSchedTask::SleepUs(unsigned aus)
+{
+	SleepUntil(CLOCKCNT + aus * (SystemCoreClock / 1000000));
+}
+
+void TSchedTask::WaitForTask(TSchedTask * atask)
+{
+	waittask = atask;
+}
+
+void TSchedTask::Complete()
+{
+	if (!scheduler)
+	{
+		return;
+	}
+
+	TSchedTask * task = scheduler->firsttask;
+	while (task)
+	{
+		if (task->waittask == this)
+		{
+			task->signaled = true;
+		}
+		task = task->nexttask;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// TScheduler
+//-----------------------------------------------------------------------------
+
+void TScheduler::AddTask(TSchedTask * atask, PSchedTaskFunc afunc, void * aarg)
+{
+	atask->func = afunc;
+	atask->arg = aarg;
+	atask->scheduler = this;
+	atask->polling = true;  // run it at least once
+	atask->nexttask = nullptr;
+
+	if (!firsttask)
+	{
+		firsttask = atask;
+		return;
+	}
+
+	TSchedTask * task = firsttask;
+	while (task->nexttask)
+	{
+		task = task->nexttask;
+	}
+	task->nexttask = atask;
+}
+
+void TScheduler::RemoveTask(TSchedTask * atask)
+{
+	TSchedTask * prev = nullptr;
+	TSchedTask * task = firsttask;
+	while (task)
+	{
+		if (task == atask)
+		{
+			if (prev)  prev->nexttask = task->nexttask;
+			else       firsttask = task->nexttask;
+
+			atask->scheduler = nullptr;
+			atask->nexttask = nullptr;
+			return;
+		}
+		prev = task;
+		task = task->nexttask;
+	}
+}
+
+bool TScheduler::TaskReady(TSchedTask * atask, clockcnt_t t)
+{
+	if (atask->polling || atask->signaled)
+	{
+		return true;
+	}
+
+	if (atask->deadline_active && (int(t - atask->deadline) >= 0))
+	{
+		return true;
+	}
+
+	return false;
+}
+
+unsigned TScheduler::NextDeadline(clockcnt_t t)
+{
+	unsigned result = SCHED_NO_DEADLINE;
+
+	TSchedTask * task = firsttask;
+	while (task)
+	{
+		if (task->deadline_active)
+		{
+			int remaining = int(task->deadline - t);
+			if (remaining <= 0)
+			{
+				return 0;
+			}
+			if (unsigned(remaining) < result)
+			{
+				result = remaining;
+			}
+		}
+		task = task->nexttask;
+	}
+
+	return result;
+}
+
+bool TScheduler::Run()
+{
+	bool dispatched = false;
+
+	clockcnt_t t = CLOCKCNT;
+	TSchedTask * task = firsttask;
+	while (task)
+	{
+		if (TaskReady(task, t))
+		{
+			// clear the wait conditions, the task function sets the new ones
+			task->signaled = false;
+			task->deadline_active = false;
+			task->waittask = nullptr;
+			task->polling = false;
+
+			++task->run_count;
+			bool busy = (*task->func)(task->arg);
+
+			if (busy && !task->deadline_active && !task->waittask)
+			{
+				task->polling = true;
+			}
+
+			dispatched = true;
+			t = CLOCKCNT;
+		}
+		task = task->nexttask;
+	}
+
+	if (dispatched)
+	{
+		return true;
+	}
+
+	// nothing to do, re-check with disabled interrupts to not to miss a Signal() from an IRQ
+	// the WFI wakes up on pending interrupts also when they are disabled
+
+	mcu_disable_interrupts();
+
+	t = CLOCKCNT;
+	task = firsttask;
+	while (task)
+	{
+		if (TaskReady(task, t))
+		{
+			break;
+		}
+		task = task->nexttask;
+	}
+
+	if (!task)
+	{
+		++idle_count;
+		Idle(NextDeadline(t));
+	}
+
+	mcu_enable_interrupts();
+
+	return false;
+}
+
+void TScheduler::RunForever()
+{
+	while (true)
+	{
+		Run();
+	}
+}
+
+void TScheduler::Idle(unsigned aclocks)
+{
+	if (!idle_sleep)
+	{
+		return;
+	}
+
+	if (idleman)
+	{
+		idleman->Idle(aclocks);
+		return;
+	}
+
+	if (aclocks < idle_min_clocks)
+	{
+		return;
+	}
+
+	if (SCHED_NO_DEADLINE == aclocks)
+	{
+		__DSB();
+		__WFI();
+		return;
+	}
+
+	if (!use_systick_wakeup)
+	{
+		return;  // no wake up source for the deadline, continue polling
+	}
+
+	hwlowpower.SysTickSleep(aclocks, idle_min_clocks);  // keeps the periodic SysTick users running
+}
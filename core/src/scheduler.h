@@ -0,0 +1,131 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     scheduler.h
+ *  brief:    Event-driven cooperative scheduler for the Run() state machines
+ *  version:  1.00
+ *  date:     2021-08-05
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    The task function returns true when it must be polled again (busy), false when it can sleep.
+ *    A sleeping task is dispatched only when
+ *      - Signal() was called (also from IRQ context, e.g. DMA or peripheral completion)
+ *      - the deadline set by SleepUntil() / SleepClocks() / SleepUs() is reached
+ *      - the task given to WaitForTask() calls its Complete()
+ *    The wait conditions must be set from the task function, they are cleared before each dispatch.
+ *    When no task is ready the scheduler calls Idle(), which puts the CPU into WFI,
+ *    or hands over to the idleman (TIdleManager) for the tickless low power handling.
+ *
+ *    Existing drivers with Run() can be added with the helper templates:
+ *      sched.AddTask(&flashtask, sched_run_obj<TSpiFlash>, &spiflash);             // polled always
+ *      sched.AddTask(&flashtask, sched_run_until_completed<TSpiFlash>, &spiflash); // sleeps when completed
+*/
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include "platform.h"
+#include "clockcnt.h"
+
+#define SCHED_NO_DEADLINE  0xFFFFFFFF
+
+class TScheduler;
+class TSchedTask;
+class TIdleManager;
+
+typedef bool (* PSchedTaskFunc)(void * arg);  // returns true when busy (must be polled again)
+
+class TSchedTask
+{
+	friend class TScheduler;
+
+public:
+	PSchedTaskFunc      func = nullptr;
+	void *              arg = nullptr;
+
+	volatile bool       signaled = false;
+	bool                deadline_active = false;
+	clockcnt_t          deadline = 0;
+	TSchedTask *        waittask = nullptr;
+
+	unsigned            run_count = 0;  // statistics
+
+	inline void         Signal()  { signaled = true; }  // IRQ safe
+
+	void                SleepUntil(clockcnt_t adeadline);
+	void                SleepClocks(unsigned aclocks);
+	void                SleepUs(unsigned aus);
+	void                WaitForTask(TSchedTask * atask);
+
+	void                Complete();  // wakes up the tasks waiting for this one
+
+protected:
+	TScheduler *        scheduler = nullptr;
+	TSchedTask *        nexttask = nullptr;
+	bool                polling = true;
+};
+
+class TScheduler
+{
+public:
+	TSchedTask *        firsttask = nullptr;
+
+	bool                idle_sleep = true;           // false = never enter WFI
+	bool                use_systick_wakeup = false;  // use the SysTick for waking up at the deadlines
+	unsigned            idle_min_clocks = 2000;      // below this do not go to sleep
+	TIdleManager *      idleman = nullptr;           // when set, it handles the idle (tickless low power)
+
+	unsigned            idle_count = 0;  // statistics
+
+	virtual             ~TScheduler() { }
+
+	void                AddTask(TSchedTask * atask, PSchedTaskFunc afunc, void * aarg);
+	void                RemoveTask(TSchedTask * atask);
+
+	bool                Run();  // one dispatch round, returns true when some task was dispatched
+	void                RunForever();
+
+	virtual void        Idle(unsigned aclocks);  // aclocks = time until the next deadline or SCHED_NO_DEADLINE
+
+protected:
+	bool                TaskReady(TSchedTask * atask, clockcnt_t t);
+	unsigned            NextDeadline(clockcnt_t t);
+};
+
+// helpers for the driver objects with Run()
+
+template <class T>
+bool sched_run_obj(void * aobj)
+{
+	((T *)aobj)->Run();
+	return true;
+}
+
+template <class T>
+bool sched_run_until_completed(void * aobj)
+{
+	T * obj = (T *)aobj;
+	obj->Run();
+	return !obj->completed;
+}
+
+#endif /* SCHEDULER_H_ */
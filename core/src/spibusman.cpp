@@ -0,0 +1,249 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     spibusman.cpp
+ *  brief:    SPI bus manager: DMA transaction queue for multiple devices on the same THwSpi
+ *  version:  1.00
+ *  date:     2021-08-07
+ *  authors:  nvitya
+*/
+
+#include "platform.h"
+#include "spibusman.h"
+
+#define SPIBUS_STATE_IDLE      0
+#define SPIBUS_STATE_XFER      1
+
+bool TSpiBusManager::Init(THwSpi * aspi)
+{
+	initialized = false;
+
+	spi = aspi;
+	if (!spi || !spi->initialized)
+	{
+		return false;
+	}
+
+	if (!spi->txdma || !spi->rxdma)
+	{
+		return false;  // DMA is mandatory
+	}
+
+	firsttra = nullptr;
+	curtra = nullptr;
+	curdevice = nullptr;
+	state = SPIBUS_STATE_IDLE;
+
+	initialized = true;
+	return true;
+}
+
+bool TSpiBusManager::AddTransaction(TSpiBusTrans * atra, TSpiBusDevice * adevice, TSpiTransfer * axfer)
+{
+	atra->device = adevice;
+	atra->xfer = axfer;
+
+	return AddTransaction(atra);
+}
+
+bool TSpiBusManager::AddTransaction(TSpiBusTrans * atra)
+{
+	if (!initialized || !atra->device)
+	{
+		atra->errorcode = ERROR_NOTINIT;
+		atra->completed = true;
+		return false;
+	}
+
+	atra->completed = false;
+	atra->errorcode = 0;
+	atra->next = nullptr;
+
+	uint8_t prio = atra->device->priority;
+
+	// insert after the last transaction with the same or higher priority
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	TSpiBusTrans * prev = nullptr;
+	TSpiBusTrans * tra = firsttra;
+	while (tra && (tra->device->priority >= prio))
+	{
+		prev = tra;
+		tra = tra->next;
+	}
+
+	atra->next = tra;
+	if (prev)  prev->next = atra;
+	else       firsttra = atra;
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+
+	return true;
+}
+
+void TSpiBusManager::WaitTransaction(TSpiBusTrans * atra)
+{
+	while (!atra->completed)
+	{
+		Run();
+	}
+}
+
+void TSpiBusManager::SelectDevice(TSpiBusDevice * adevice)
+{
+	if (adevice != curdevice)
+	{
+		if ( (!curdevice)
+				 || (adevice->speed != spi->speed)
+				 || (adevice->idleclk_high != spi->idleclk_high)
+				 || (adevice->datasample_late != spi->datasample_late)
+				 || (adevice->lsb_first != spi->lsb_first)
+			 )
+		{
+			spi->speed = adevice->speed;
+			spi->idleclk_high = adevice->idleclk_high;
+			spi->datasample_late = adevice->datasample_late;
+			spi->lsb_first = adevice->lsb_first;
+
+			spi->ClockChanged();  // re-applies the settings on every vendor, keeps the DMA assignments
+		}
+
+		curdevice = adevice;
+	}
+
+	if (adevice->cspin)
+	{
+		adevice->cspin->Set0();
+	}
+}
+
+void TSpiBusManager::StartChunk()
+{
+	chunksize = remaining;
+	if (chunksize > HW_DMA_MAX_COUNT)  chunksize = HW_DMA_MAX_COUNT;
+
+	txfer.bytewidth = 1;
+	txfer.count = chunksize;
+	if (srcptr)
+	{
+		txfer.srcaddr = srcptr;
+		txfer.flags = 0;
+	}
+	else
+	{
+		dummy_tx = 0;
+		txfer.srcaddr = &dummy_tx;
+		txfer.flags = DMATR_NO_ADDR_INC;  // sending the same zero character
+	}
+
+	rxfer.bytewidth = 1;
+	rxfer.count = chunksize;
+	if (dstptr)
+	{
+		rxfer.dstaddr = dstptr;
+		rxfer.flags = 0;
+	}
+	else
+	{
+		rxfer.dstaddr = &dummy_rx;
+		rxfer.flags = DMATR_NO_ADDR_INC;  // ignore the received data
+	}
+
+	spi->DmaStartRecv(&rxfer);
+	spi->DmaStartSend(&txfer);
+}
+
+void TSpiBusManager::FinishCurTra(int aerror)
+{
+	if (curtra->device->cspin)
+	{
+		curtra->device->cspin->Set1();
+	}
+
+	TSpiBusTrans * tra = curtra;
+	curtra = nullptr;
+	state = SPIBUS_STATE_IDLE;
+
+	// the callback might add the same transaction object again
+	tra->errorcode = aerror;
+	tra->completed = true;
+	if (tra->callback)
+	{
+		(* (tra->callback))(tra->callbackarg);
+	}
+}
+
+void TSpiBusManager::Run()
+{
+	if (SPIBUS_STATE_IDLE == state)
+	{
+		if (!firsttra)
+		{
+			return;
+		}
+
+		// take the first (highest priority) transaction
+
+		unsigned pm = __get_PRIMASK();  // save interrupt disable status
+		__disable_irq();
+		curtra = firsttra;
+		firsttra = firsttra->next;
+	 	__set_PRIMASK(pm); // restore interrupt disable status
+
+		SelectDevice(curtra->device);
+
+		curxfer = curtra->xfer;
+		remaining = 0;
+		state = SPIBUS_STATE_XFER;
+	}
+	else if (SPIBUS_STATE_XFER == state)
+	{
+		if (!spi->DmaRecvCompleted())
+		{
+			return;
+		}
+
+		if (srcptr)  srcptr += chunksize;
+		if (dstptr)  dstptr += chunksize;
+		remaining -= chunksize;
+	}
+
+	// start the next chunk or transfer
+
+	while (0 == remaining)
+	{
+		if (!curxfer)
+		{
+			FinishCurTra(0);
+			Run();  // start the next transaction immediately
+			return;
+		}
+
+		srcptr = (uint8_t *)curxfer->src;
+		dstptr = (uint8_t *)curxfer->dst;
+		remaining = curxfer->length;
+		curxfer = curxfer->next;
+	}
+
+	StartChunk();
+}
@@ -0,0 +1,115 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     spibusman.h
+ *  brief:    SPI bus manager: DMA transaction queue for multiple devices on the same THwSpi
+ *  version:  1.00
+ *  date:     2021-08-07
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    Every device has its own chip select, speed and SPI mode. The transactions (TSpiTransfer chains)
+ *    are executed back to back with DMA, the chip select stays active for the whole chain.
+ *    Higher priority devices are served first, but a running transaction is never interrupted.
+ *    The THwSpi must be initialized and its DMA channels assigned (DmaAssign) before Init().
+ *    The Run() must be called periodically, but only from one context (main loop or the RX DMA IRQ).
+*/
+
+#ifndef SPIBUSMAN_H_
+#define SPIBUSMAN_H_
+
+#include "platform.h"
+#include "hwpins.h"
+#include "hwspi.h"
+#include "hwdma.h"
+#include "errors.h"
+
+class TSpiBusDevice
+{
+public:
+	TGpioPin *         cspin = nullptr;
+
+	unsigned           speed = 1000000;
+	bool               idleclk_high = false;
+	bool               datasample_late = false;
+	bool               lsb_first = false;
+
+	uint8_t            priority = 0;  // higher value = served first
+};
+
+typedef void (* PSpiBusCbFunc)(void * arg);
+
+class TSpiBusTrans
+{
+public:
+	TSpiBusDevice *    device = nullptr;
+	TSpiTransfer *     xfer = nullptr;    // transfer chain, executed with one CS activation
+
+	volatile bool      completed = true;
+	int                errorcode = 0;
+
+	PSpiBusCbFunc      callback = nullptr;
+	void *             callbackarg = nullptr;
+
+	TSpiBusTrans *     next = nullptr;
+};
+
+class TSpiBusManager
+{
+public:
+	THwSpi *           spi = nullptr;
+	bool               initialized = false;
+
+	bool               Init(THwSpi * aspi);
+
+	bool               AddTransaction(TSpiBusTrans * atra);
+	bool               AddTransaction(TSpiBusTrans * atra, TSpiBusDevice * adevice, TSpiTransfer * axfer);
+
+	void               WaitTransaction(TSpiBusTrans * atra); // blocking
+	inline bool        Idle() { return (!curtra && !firsttra); }
+
+	void               Run();
+
+protected:
+	int                state = 0;
+
+	TSpiBusTrans *     firsttra = nullptr;
+	TSpiBusTrans *     curtra = nullptr;
+	TSpiBusDevice *    curdevice = nullptr;  // the SPI is configured for this device
+
+	TSpiTransfer *     curxfer = nullptr;
+	uint8_t *          srcptr = nullptr;
+	uint8_t *          dstptr = nullptr;
+	unsigned           remaining = 0;
+	unsigned           chunksize = 0;
+
+	uint8_t            dummy_tx = 0;
+	uint8_t            dummy_rx = 0;
+
+	THwDmaTransfer     txfer;
+	THwDmaTransfer     rxfer;
+
+	void               SelectDevice(TSpiBusDevice * adevice);
+	void               StartChunk();
+	void               FinishCurTra(int aerror);
+};
+
+#endif /* SPIBUSMAN_H_ */
@@ -0,0 +1,330 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     timerwheel.cpp
+ *  brief:    Hashed timer wheel for timeouts and periodic callbacks
+ *  version:  1.00
+ *  date:     2021-08-13
+ *  authors:  nvitya
+*/
+
+#include "platform.h"
+#include "timerwheel.h"
+
+static_assert((TIMERWHEEL_SLOTS & (TIMERWHEEL_SLOTS - 1)) == 0, "TIMERWHEEL_SLOTS must be power of 2");
+
+TTimerWheel  timerwheel;
+
+bool TTimerWheel::Init(unsigned atick_us)
+{
+	tick_us = atick_us;
+	tick_clocks = atick_us * (SystemCoreClock / 1000000);
+	if (!tick_clocks)
+	{
+		return false;
+	}
+
+	base_clocks = clockcnt64();
+	base_tick = 0;
+	curtick = 0;
+	return true;
+}
+
+uint64_t TTimerWheel::CurrentTick()
+{
+	return base_tick + (clockcnt64() - base_clocks) / tick_clocks;
+}
+
+void TTimerWheel::ClockChanged()
+{
+	unsigned newtick_clocks = tick_us * (SystemCoreClock / 1000000);
+	if (!tick_clocks || !newtick_clocks)
+	{
+		return;
+	}
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	// rebase, the started part of the current tick continues with the new speed
+	uint64_t now = clockcnt64();
+	uint64_t elapsed = now - base_clocks;
+	base_tick += elapsed / tick_clocks;
+	base_clocks = now - (elapsed % tick_clocks) * newtick_clocks / tick_clocks;
+	tick_clocks = newtick_clocks;
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+}
+
+void TTimerWheel::Insert(TTimer * atimer)
+{
+	if (atimer->expire_tick <= curtick)
+	{
+		atimer->expire_tick = curtick + 1;  // the current tick is already processed
+	}
+
+	TTimer ** phead = &slots[atimer->expire_tick & (TIMERWHEEL_SLOTS - 1)];
+	atimer->prev = nullptr;
+	atimer->next = *phead;
+	if (*phead)
+	{
+		(*phead)->prev = atimer;
+	}
+	*phead = atimer;
+	atimer->listhead = phead;
+
+	++activecount;
+}
+
+void TTimerWheel::Unlink(TTimer * atimer)
+{
+	if (!atimer->listhead)
+	{
+		return;
+	}
+
+	if (atimer->prev)
+	{
+		atimer->prev->next = atimer->next;
+	}
+	else
+	{
+		*(atimer->listhead) = atimer->next;
+	}
+
+	if (atimer->next)
+	{
+		atimer->next->prev = atimer->prev;
+	}
+
+	atimer->listhead = nullptr;
+	atimer->next = nullptr;
+	atimer->prev = nullptr;
+
+	--activecount;
+}
+
+void TTimerWheel::StartTicks(TTimer * atimer, unsigned adelayticks, unsigned aperiodticks)
+{
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	Unlink(atimer);
+	atimer->period_ticks = aperiodticks;
+	atimer->expire_tick = CurrentTick() + (adelayticks ? adelayticks : 1);
+	Insert(atimer);
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+}
+
+void TTimerWheel::Start(TTimer * atimer, unsigned aus)
+{
+	StartTicks(atimer, (aus + tick_us - 1) / tick_us, 0);
+}
+
+void TTimerWheel::StartPeriodic(TTimer * atimer, unsigned aus)
+{
+	unsigned ticks = (aus + tick_us - 1) / tick_us;
+	StartTicks(atimer, ticks, (ticks ? ticks : 1));
+}
+
+void TTimerWheel::Stop(TTimer * atimer)
+{
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	Unlink(atimer);
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+}
+
+void TTimerWheel::ProcessSlot(unsigned aslot, uint64_t anowtick)  // called with disabled interrupts
+{
+	// move the expired timers to the fire list, the later ones (further rounds) remain
+
+	TTimer * timer = slots[aslot];
+	while (timer)
+	{
+		TTimer * nexttimer = timer->next;
+		if (timer->expire_tick <= anowtick)
+		{
+			Unlink(timer);
+
+			timer->next = firelist;
+			timer->prev = nullptr;
+			if (firelist)
+			{
+				firelist->prev = timer;
+			}
+			firelist = timer;
+			timer->listhead = &firelist;
+			++activecount;
+		}
+		timer = nexttimer;
+	}
+}
+
+void TTimerWheel::Run()
+{
+	if (!tick_clocks)
+	{
+		return;
+	}
+
+	uint64_t nowtick = CurrentTick();
+	if (nowtick <= curtick)
+	{
+		return;
+	}
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	// visit the slots of the elapsed ticks, but every slot only once
+
+	uint64_t tick = curtick + 1;
+	uint64_t lasttick = nowtick;
+	if (lasttick - curtick > TIMERWHEEL_SLOTS)
+	{
+		lasttick = curtick + TIMERWHEEL_SLOTS;
+	}
+
+	while (tick <= lasttick)
+	{
+		ProcessSlot(tick & (TIMERWHEEL_SLOTS - 1), nowtick);
+		++tick;
+	}
+
+	curtick = nowtick;
+
+	// call the callbacks, the timers are always taken from the head, because the callbacks might change the list
+
+	TTimer * timer;
+	while ((timer = firelist) != nullptr)
+	{
+		Unlink(timer);
+
+		if (timer->period_ticks)
+		{
+			// re-arm, the missed periods are skipped
+			timer->expire_tick += timer->period_ticks;
+			if (timer->expire_tick <= nowtick)
+			{
+				timer->expire_tick = nowtick + timer->period_ticks - ((nowtick - timer->expire_tick) % timer->period_ticks);
+			}
+			Insert(timer);
+		}
+
+	 	__set_PRIMASK(pm); // restore interrupt disable status
+
+		if (timer->callback)
+		{
+			(* (timer->callback))(timer->callbackarg);
+		}
+
+		__disable_irq();
+	}
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+}
+
+uint64_t TTimerWheel::NextExpireTick()
+{
+	uint64_t result = 0;
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	if (activecount)
+	{
+		// the slots are searched in tick order, the first slot with a timer of the current round gives the result
+		for (unsigned n = 1; n <= TIMERWHEEL_SLOTS; ++n)
+		{
+			uint64_t tick = curtick + n;
+			TTimer * timer = slots[tick & (TIMERWHEEL_SLOTS - 1)];
+			while (timer)
+			{
+				if (timer->expire_tick <= tick)
+				{
+					result = tick;
+					break;
+				}
+				timer = timer->next;
+			}
+			if (result)
+			{
+				break;
+			}
+		}
+
+		if (!result)
+		{
+			result = curtick + TIMERWHEEL_SLOTS;  // only timers in further rounds: check again after one round
+		}
+	}
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+
+	return result;
+}
+
+unsigned TTimerWheel::TicksToNext()
+{
+	uint64_t nexttick = NextExpireTick();
+	if (!nexttick || !tick_clocks)
+	{
+		return 0xFFFFFFFF;
+	}
+
+	// against the real time, the Run() might be late
+	uint64_t nowtick = CurrentTick();
+	if (nexttick <= nowtick)
+	{
+		return 0;
+	}
+	return unsigned(nexttick - nowtick);
+}
+
+unsigned TTimerWheel::ClocksToNext()
+{
+	uint64_t nexttick = NextExpireTick();
+	if (!nexttick || !tick_clocks)
+	{
+		return 0xFFFFFFFF;
+	}
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	// the start of the expiry tick, the ClockChanged() might rebase meanwhile
+	uint64_t expclocks = base_clocks + (nexttick - base_tick) * tick_clocks;
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+
+	uint64_t now = clockcnt64();
+	if (expclocks <= now)
+	{
+		return 0;
+	}
+
+	uint64_t result = expclocks - now;
+	return (result < 0xFFFFFFFF ? unsigned(result) : 0xFFFFFFFF);
+}
@@ -0,0 +1,111 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     timerwheel.h
+ *  brief:    Hashed timer wheel for timeouts and periodic callbacks
+ *  version:  1.00
+ *  date:     2021-08-13
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    The timers are hashed into TIMERWHEEL_SLOTS lists by their expiry tick, so Start() / Stop()
+ *    are O(1) and the Run() checks only the lists of the elapsed ticks.
+ *    Start() / Stop() can be called from interrupt context and from the callbacks too.
+ *    The callbacks are called from the Run(), which must be called regularly (main loop, scheduler task
+ *    or a periodic IRQ). The ticks come from the clockcnt64(), see its wrap requirements in the clockcnt.h.
+ *    usage:
+ *
+ *      timerwheel.Init(1000);                          // 1 ms tick
+ *      timerwheel.StartPeriodic(&blinktimer, 500000);  // 500 ms, blinktimer.callback must be set
+ *      ...
+ *      timerwheel.Run();
+*/
+
+#ifndef TIMERWHEEL_H_
+#define TIMERWHEEL_H_
+
+#include "platform.h"
+#include "clockcnt.h"
+
+#ifndef TIMERWHEEL_SLOTS
+  #define TIMERWHEEL_SLOTS  64  // must be power of 2
+#endif
+
+typedef void (* PTimerCbFunc)(void * arg);
+
+class TTimer
+{
+	friend class TTimerWheel;
+
+public:
+	PTimerCbFunc       callback = nullptr;
+	void *             callbackarg = nullptr;
+
+	uint64_t           expire_tick = 0;
+	unsigned           period_ticks = 0;  // 0 = one-shot
+
+	inline bool        Active() { return (listhead != nullptr); }
+
+protected:
+	TTimer *           next = nullptr;
+	TTimer *           prev = nullptr;
+	TTimer **          listhead = nullptr;  // the containing list, nullptr = not active
+};
+
+class TTimerWheel
+{
+public:
+	unsigned           tick_us = 1000;
+	unsigned           tick_clocks = 0;
+	uint64_t           curtick = 0;         // the last processed tick
+
+	bool               Init(unsigned atick_us);
+
+	void               Start(TTimer * atimer, unsigned aus);          // one-shot
+	void               StartPeriodic(TTimer * atimer, unsigned aus);  // the first expiry comes after aus too
+	void               StartTicks(TTimer * atimer, unsigned adelayticks, unsigned aperiodticks);
+	void               Stop(TTimer * atimer);
+
+	uint64_t           CurrentTick();       // from the clockcnt64()
+	unsigned           TicksToNext();       // from the current tick, 0 = Run() required, 0xFFFFFFFF = no active timer
+	unsigned           ClocksToNext();      // for the idle handling, 0xFFFFFFFF = no active timer (or too far)
+
+	void               ClockChanged();      // recalculates the tick_clocks after a CPU speed change
+
+	void               Run();
+
+protected:
+	uint64_t           base_clocks = 0;     // clockcnt64() at base_tick, the tick length might change
+	uint64_t           base_tick = 0;
+
+	TTimer *           slots[TIMERWHEEL_SLOTS] = {};
+	TTimer *           firelist = nullptr;
+	unsigned           activecount = 0;
+
+	void               Insert(TTimer * atimer);  // called with disabled interrupts
+	void               Unlink(TTimer * atimer);  // called with disabled interrupts
+	void               ProcessSlot(unsigned aslot, uint64_t anowtick);
+	uint64_t           NextExpireTick();         // 0 = no active timer
+};
+
+extern TTimerWheel  timerwheel;
+
+#endif /* TIMERWHEEL_H_ */
@@ -0,0 +1,630 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     tlsfheap.cpp
+ *  brief:    TLSF (two-level segregated fit) heap with multiple memory regions
+ *  version:  1.00
+ *  date:     2021-08-12
+ *  authors:  nvitya
+*/
+
+#include "string.h"
+#include "tlsfheap.h"
+
+TTlsfHeap  tlsfheap;
+
+#define TLSF_BLOCK_FREE   1
+
+static inline TTlsfBlock * tlsf_phys_next(TTlsfBlock * ablock)
+{
+	return (TTlsfBlock *)((uint8_t *)ablock + TLSF_HEADER_SIZE + (ablock->size & ~TLSF_BLOCK_FREE));
+}
+
+static inline void tlsf_mapping_insert(unsigned asize, unsigned * rfl, unsigned * rsl)
+{
+	if (asize < TLSF_SMALL_BLOCK)
+	{
+		*rfl = 0;
+		*rsl = (asize >> TLSF_ALIGN_SHIFT);
+	}
+	else
+	{
+		unsigned fl = 31 - __builtin_clz(asize);
+		*rsl = ((asize >> (fl - TLSF_SL_SHIFT)) ^ TLSF_SL_COUNT);
+		*rfl = fl - (TLSF_FL_SHIFT - 1);
+	}
+}
+
+static inline void tlsf_mapping_search(unsigned asize, unsigned * rfl, unsigned * rsl)
+{
+	// round up to the next list, so every block in the found list is big enough
+	if (asize >= TLSF_SMALL_BLOCK)
+	{
+		asize += (1 << ((31 - __builtin_clz(asize)) - TLSF_SL_SHIFT)) - 1;
+	}
+	tlsf_mapping_insert(asize, rfl, rsl);
+}
+
+bool TTlsfRegion::Init(void * aaddr, unsigned asize, unsigned atag)
+{
+	uint8_t * start = (uint8_t *)(((unsigned)aaddr + TLSF_ALIGN - 1) & ~(TLSF_ALIGN - 1));
+	uint8_t * end = (uint8_t *)(((unsigned)aaddr + asize) & ~(TLSF_ALIGN - 1));
+
+	if (end <= start + 2 * TLSF_HEADER_SIZE + TLSF_MIN_BLOCK)
+	{
+		return false;
+	}
+
+	unsigned bsize = end - start - 2 * TLSF_HEADER_SIZE;
+	if (bsize >= (1u << TLSF_FL_MAX))
+	{
+		bsize = (1u << TLSF_FL_MAX) - TLSF_ALIGN;
+		end = start + bsize + 2 * TLSF_HEADER_SIZE;
+	}
+
+	startaddr = start;
+	endaddr = end;
+	tag = atag;
+	totalbytes = end - start;
+	usedbytes = 0;
+	peakusedbytes = 0;
+	alloccount = 0;
+	failcount = 0;
+
+	fl_bitmap = 0;
+	memset(&sl_bitmap[0], 0, sizeof(sl_bitmap));
+	memset(&freelist[0][0], 0, sizeof(freelist));
+
+	// one big free block and a zero sized used block (sentinel) at the end
+
+	TTlsfBlock * block = (TTlsfBlock *)start;
+	block->prev_phys = nullptr;
+	block->size = bsize | TLSF_BLOCK_FREE;
+
+	TTlsfBlock * sentinel = tlsf_phys_next(block);
+	sentinel->prev_phys = block;
+	sentinel->size = 0;
+
+	InsertFree(block);
+
+	return true;
+}
+
+void TTlsfRegion::InsertFree(TTlsfBlock * ablock)
+{
+	unsigned fl, sl;
+	tlsf_mapping_insert(ablock->size & ~TLSF_BLOCK_FREE, &fl, &sl);
+
+	TTlsfBlock * head = freelist[fl][sl];
+	ablock->next_free = head;
+	ablock->prev_free = nullptr;
+	if (head)
+	{
+		head->prev_free = ablock;
+	}
+	freelist[fl][sl] = ablock;
+
+	fl_bitmap |= (1 << fl);
+	sl_bitmap[fl] |= (1 << sl);
+}
+
+void TTlsfRegion::RemoveFree(TTlsfBlock * ablock)
+{
+	unsigned fl, sl;
+	tlsf_mapping_insert(ablock->size & ~TLSF_BLOCK_FREE, &fl, &sl);
+
+	if (ablock->prev_free)
+	{
+		ablock->prev_free->next_free = ablock->next_free;
+	}
+	else
+	{
+		freelist[fl][sl] = ablock->next_free;
+	}
+
+	if (ablock->next_free)
+	{
+		ablock->next_free->prev_free = ablock->prev_free;
+	}
+
+	if (!freelist[fl][sl])
+	{
+		sl_bitmap[fl] &= ~(1 << sl);
+		if (!sl_bitmap[fl])
+		{
+			fl_bitmap &= ~(1 << fl);
+		}
+	}
+}
+
+void * TTlsfRegion::Alloc(unsigned asize)
+{
+	if (!startaddr || !asize || (asize >= (1u << TLSF_FL_MAX) - TLSF_ALIGN))
+	{
+		return nullptr;
+	}
+
+	unsigned size = ((asize + TLSF_ALIGN - 1) & ~(TLSF_ALIGN - 1));
+	if (size < TLSF_MIN_BLOCK)  size = TLSF_MIN_BLOCK;
+
+	unsigned fl, sl;
+	tlsf_mapping_search(size, &fl, &sl);
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	TTlsfBlock * block = nullptr;
+
+	uint32_t slmap = sl_bitmap[fl] & (0xFFFFFFFF << sl);
+	if (!slmap)
+	{
+		uint32_t flmap = fl_bitmap & (0xFFFFFFFF << (fl + 1));
+		if (flmap)
+		{
+			fl = __builtin_ctz(flmap);
+			slmap = sl_bitmap[fl];
+		}
+	}
+
+	if (slmap)
+	{
+		sl = __builtin_ctz(slmap);
+		block = freelist[fl][sl];
+		RemoveFree(block);
+
+		unsigned bsize = (block->size & ~TLSF_BLOCK_FREE);
+		if (bsize >= size + TLSF_HEADER_SIZE + TLSF_MIN_BLOCK)
+		{
+			// split, the rest goes back to the free lists
+			TTlsfBlock * rest = (TTlsfBlock *)((uint8_t *)block + TLSF_HEADER_SIZE + size);
+			rest->prev_phys = block;
+			rest->size = (bsize - size - TLSF_HEADER_SIZE) | TLSF_BLOCK_FREE;
+			tlsf_phys_next(rest)->prev_phys = rest;
+			InsertFree(rest);
+
+			block->size = size;
+		}
+		else
+		{
+			block->size = bsize;
+		}
+
+		usedbytes += block->size + TLSF_HEADER_SIZE;
+		if (usedbytes > peakusedbytes)  peakusedbytes = usedbytes;
+		++alloccount;
+	}
+	else
+	{
+		++failcount;
+	}
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+
+	if (!block)
+	{
+		return nullptr;
+	}
+
+	return &block->next_free;  // the user data starts after the header
+}
+
+void * TTlsfRegion::AllocAligned(unsigned asize, unsigned aalign)
+{
+	if (aalign <= TLSF_ALIGN)
+	{
+		return Alloc(asize);
+	}
+
+	if (aalign & (aalign - 1))
+	{
+		return nullptr;  // not power of 2
+	}
+
+	if (!asize || (asize >= (1u << TLSF_FL_MAX) - aalign - 2 * (TLSF_HEADER_SIZE + TLSF_MIN_BLOCK)))
+	{
+		return nullptr;
+	}
+
+	unsigned size = ((asize + TLSF_ALIGN - 1) & ~(TLSF_ALIGN - 1));
+	if (size < TLSF_MIN_BLOCK)  size = TLSF_MIN_BLOCK;
+
+	// allocate with reserve for an aligned start which leaves a valid free block before it
+	uint8_t * ptr = (uint8_t *)Alloc(size + aalign + TLSF_HEADER_SIZE + TLSF_MIN_BLOCK);
+	if (!ptr)
+	{
+		return nullptr;
+	}
+
+	uint8_t * aptr = (uint8_t *)(((unsigned)ptr + aalign - 1) & ~(aalign - 1));
+	if ((aptr != ptr) && (unsigned(aptr - ptr) < TLSF_HEADER_SIZE + TLSF_MIN_BLOCK))
+	{
+		aptr += aalign;
+	}
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	TTlsfBlock * block = (TTlsfBlock *)(ptr - TLSF_HEADER_SIZE);
+	TTlsfBlock * head = nullptr;
+	TTlsfBlock * tail = nullptr;
+
+	if (aptr != ptr)
+	{
+		// the head becomes a separate block
+		head = block;
+		block = (TTlsfBlock *)(aptr - TLSF_HEADER_SIZE);
+		block->prev_phys = head;
+		block->size = head->size - (aptr - ptr);
+		tlsf_phys_next(block)->prev_phys = block;
+		head->size = (aptr - ptr) - TLSF_HEADER_SIZE;
+	}
+
+	if (block->size >= size + TLSF_HEADER_SIZE + TLSF_MIN_BLOCK)
+	{
+		// the tail becomes a separate block
+		tail = (TTlsfBlock *)(aptr + size);
+		tail->prev_phys = block;
+		tail->size = block->size - size - TLSF_HEADER_SIZE;
+		tlsf_phys_next(tail)->prev_phys = tail;
+		block->size = size;
+	}
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+
+	// give back the unused parts (merged with the free neighbors)
+	if (head)  Free(&head->next_free);
+	if (tail)  Free(&tail->next_free);
+
+	return aptr;
+}
+
+void TTlsfRegion::Free(void * aptr)
+{
+	TTlsfBlock * block = (TTlsfBlock *)((uint8_t *)aptr - TLSF_HEADER_SIZE);
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	usedbytes -= block->size + TLSF_HEADER_SIZE;
+
+	TTlsfBlock * next = tlsf_phys_next(block);
+	TTlsfBlock * prev = block->prev_phys;
+
+	// merge with the free neighbors
+
+	if (prev && (prev->size & TLSF_BLOCK_FREE))
+	{
+		RemoveFree(prev);
+		prev->size += TLSF_HEADER_SIZE + block->size;
+		next->prev_phys = prev;
+		block = prev;
+	}
+	else
+	{
+		block->size |= TLSF_BLOCK_FREE;
+	}
+
+	if (next->size & TLSF_BLOCK_FREE)  // the sentinel is never free
+	{
+		RemoveFree(next);
+		tlsf_phys_next(next)->prev_phys = block;
+		block->size += TLSF_HEADER_SIZE + (next->size & ~TLSF_BLOCK_FREE);
+	}
+
+	InsertFree(block);
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+}
+
+unsigned TTlsfRegion::MaxAllocSize()
+{
+	// the lower bound of the highest non-empty list
+
+	uint32_t flmap = fl_bitmap;
+	if (!flmap)
+	{
+		return 0;
+	}
+
+	unsigned fl = 31 - __builtin_clz(flmap);
+	unsigned sl = 31 - __builtin_clz(sl_bitmap[fl]);
+
+	if (0 == fl)
+	{
+		return (sl << TLSF_ALIGN_SHIFT);
+	}
+
+	unsigned f = fl + TLSF_FL_SHIFT - 1;
+	return (1u << f) + (sl << (f - TLSF_SL_SHIFT));
+}
+
+void TTlsfRegion::GetStats(TTlsfStats * astats)
+{
+	astats->totalbytes = totalbytes;
+	astats->usedbytes = usedbytes;
+	astats->peakusedbytes = peakusedbytes;
+	astats->alloccount = alloccount;
+	astats->failcount = failcount;
+	astats->freebytes = 0;
+	astats->largestfree = 0;
+	astats->freeblocks = 0;
+	astats->fragmentation = 0;
+
+	if (!startaddr)
+	{
+		return;
+	}
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	TTlsfBlock * block = (TTlsfBlock *)startaddr;
+	while (block->size)  // until the sentinel
+	{
+		if (block->size & TLSF_BLOCK_FREE)
+		{
+			unsigned bsize = (block->size & ~TLSF_BLOCK_FREE);
+			astats->freebytes += bsize;
+			++astats->freeblocks;
+			if (bsize > astats->largestfree)  astats->largestfree = bsize;
+		}
+		block = tlsf_phys_next(block);
+	}
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+
+	if (astats->freebytes)
+	{
+		astats->fragmentation = 100 - uint64_t(astats->largestfree) * 100 / astats->freebytes;
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+bool TTlsfHeap::AddRegion(void * aaddr, unsigned asize, unsigned atag)
+{
+	if (regioncount >= TLSF_MAX_REGIONS)
+	{
+		return false;
+	}
+
+	if (!regions[regioncount].Init(aaddr, asize, atag))
+	{
+		return false;
+	}
+
+	++regioncount;
+	return true;
+}
+
+TTlsfRegion * TTlsfHeap::FindRegion(void * aptr)
+{
+	for (unsigned n = 0; n < regioncount; ++n)
+	{
+		if (regions[n].Contains(aptr))
+		{
+			return &regions[n];
+		}
+	}
+	return nullptr;
+}
+
+void * TTlsfHeap::Alloc(unsigned asize, unsigned atags, bool astrict)
+{
+	return AllocAligned(asize, TLSF_ALIGN, atags, astrict);
+}
+
+void * TTlsfHeap::AllocAligned(unsigned asize, unsigned aalign, unsigned atags, bool astrict)
+{
+	void * result;
+	unsigned n;
+
+	// the preferred regions first
+	for (n = 0; n < regioncount; ++n)
+	{
+		if (regions[n].tag & atags)
+		{
+			result = regions[n].AllocAligned(asize, aalign);
+			if (result)  return result;
+		}
+	}
+
+	if (astrict)
+	{
+		return nullptr;
+	}
+
+	for (n = 0; n < regioncount; ++n)
+	{
+		if (0 == (regions[n].tag & atags))
+		{
+			result = regions[n].AllocAligned(asize, aalign);
+			if (result)  return result;
+		}
+	}
+
+	return nullptr;
+}
+
+void TTlsfHeap::Free(void * aptr)
+{
+	if (!aptr)
+	{
+		return;
+	}
+
+	TTlsfRegion * region = FindRegion(aptr);
+	if (region)
+	{
+		region->Free(aptr);
+	}
+}
+
+unsigned TTlsfHeap::BlockSize(void * aptr)
+{
+	if (!aptr)
+	{
+		return 0;
+	}
+
+	TTlsfBlock * block = (TTlsfBlock *)((uint8_t *)aptr - TLSF_HEADER_SIZE);
+	return (block->size & ~TLSF_BLOCK_FREE);
+}
+
+void * TTlsfHeap::Realloc(void * aptr, unsigned asize)
+{
+	if (!aptr)
+	{
+		return Alloc(asize);
+	}
+
+	if (!asize)
+	{
+		Free(aptr);
+		return nullptr;
+	}
+
+	unsigned cursize = BlockSize(aptr);
+	if (asize <= cursize)
+	{
+		return aptr;
+	}
+
+	TTlsfRegion * region = FindRegion(aptr);
+	void * result = Alloc(asize, (region ? region->tag : HEAPTAG_NORMAL));
+	if (result)
+	{
+		memcpy(result, aptr, cursize);
+		Free(aptr);
+	}
+	return result;
+}
+
+void TTlsfHeap::GetStats(TTlsfStats * astats, unsigned atags)
+{
+	TTlsfStats rstats;
+
+	*astats = rstats;  // clear
+
+	for (unsigned n = 0; n < regioncount; ++n)
+	{
+		if (regions[n].tag & atags)
+		{
+			regions[n].GetStats(&rstats);
+			astats->totalbytes    += rstats.totalbytes;
+			astats->usedbytes     += rstats.usedbytes;
+			astats->peakusedbytes += rstats.peakusedbytes;
+			astats->freebytes     += rstats.freebytes;
+			astats->freeblocks    += rstats.freeblocks;
+			astats->alloccount    += rstats.alloccount;
+			astats->failcount     += rstats.failcount;
+			if (rstats.largestfree > astats->largestfree)  astats->largestfree = rstats.largestfree;
+		}
+	}
+
+	if (astats->freebytes)
+	{
+		astats->fragmentation = 100 - uint64_t(astats->largestfree) * 100 / astats->freebytes;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// newlib malloc replacement
+
+#if defined(HEAP_TLSF_MALLOC)
+
+extern "C"
+{
+
+struct _reent;
+
+extern unsigned  __end;       // end of the used ram RAM (where the heap begins), defined in the linker script
+extern unsigned  _Heap_Limit; // end of the RAM available for heap (where the maximal size stack begins), defined in the linker script
+
+static bool tlsf_malloc_initialized = false;
+
+static void tlsf_malloc_init()
+{
+	tlsf_malloc_initialized = true;
+	tlsfheap.AddRegion(&__end, (uint8_t *)&_Heap_Limit - (uint8_t *)&__end, HEAPTAG_NORMAL);
+}
+
+void * malloc(size_t asize)
+{
+	if (!tlsf_malloc_initialized)  tlsf_malloc_init();
+	return tlsfheap.Alloc(asize);
+}
+
+void free(void * aptr)
+{
+	tlsfheap.Free(aptr);
+}
+
+void * realloc(void * aptr, size_t asize)
+{
+	if (!tlsf_malloc_initialized)  tlsf_malloc_init();
+	return tlsfheap.Realloc(aptr, asize);
+}
+
+void * calloc(size_t acount, size_t asize)
+{
+	if (asize && (acount > SIZE_MAX / asize))
+	{
+		return nullptr;  // overflow
+	}
+
+	if (!tlsf_malloc_initialized)  tlsf_malloc_init();
+	void * result = tlsfheap.Alloc(acount * asize);
+	if (result)
+	{
+		memset(result, 0, acount * asize);
+	}
+	return result;
+}
+
+void * memalign(size_t aalign, size_t asize)
+{
+	if (!tlsf_malloc_initialized)  tlsf_malloc_init();
+	return tlsfheap.AllocAligned(asize, aalign);
+}
+
+void * aligned_alloc(size_t aalign, size_t asize)
+{
+	return memalign(aalign, asize);
+}
+
+size_t malloc_usable_size(void * aptr)
+{
+	return tlsfheap.BlockSize(aptr);
+}
+
+// the newlib internal (reentrant) versions, all of them must be replaced, otherwise the mallocr.o is linked too
+
+void * _malloc_r(struct _reent * r, size_t asize)                    { return malloc(asize); }
+void   _free_r(struct _reent * r, void * aptr)                        { free(aptr); }
+void * _realloc_r(struct _reent * r, void * aptr, size_t asize)      { return realloc(aptr, asize); }
+void * _calloc_r(struct _reent * r, size_t acount, size_t asize)     { return calloc(acount, asize); }
+void * _memalign_r(struct _reent * r, size_t aalign, size_t asize)   { return memalign(aalign, asize); }
+size_t _malloc_usable_size_r(struct _reent * r, void * aptr)          { return malloc_usable_size(aptr); }
+
+} // extern "C"
+
+#endif
@@ -0,0 +1,148 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     tlsfheap.h
+ *  brief:    TLSF (two-level segregated fit) heap with multiple memory regions
+ *  version:  1.00
+ *  date:     2021-08-12
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    The allocation and the free are O(1) (constant time, no search loops), and they are interrupt
+ *    safe (short interrupt disabled sections).
+ *    The regions have tags, the allocation tries first the regions with matching tags then the others
+ *    (unless strict is requested). Example:
+ *
+ *      tlsfheap.AddRegion(&dtcram_heap[0], sizeof(dtcram_heap), HEAPTAG_FAST);
+ *      tlsfheap.AddRegion((void *)0xC0100000, 0x00700000, HEAPTAG_LARGE);  // SDRAM after the framebuffer
+ *      void * p = tlsfheap.Alloc(1024, HEAPTAG_FAST);
+ *
+ *    Defining HEAP_TLSF_MALLOC in the board.h replaces the newlib malloc family, then the linker script
+ *    defined heap area (__end .. _Heap_Limit) is added automatically as HEAPTAG_NORMAL region.
+ *    The aligned allocations (AllocAligned, memalign) split the unused head and tail back to the free lists.
+*/
+
+#ifndef TLSFHEAP_H_
+#define TLSFHEAP_H_
+
+#include "platform.h"
+
+#ifndef TLSF_MAX_REGIONS
+  #define TLSF_MAX_REGIONS   4
+#endif
+
+#define HEAPTAG_NORMAL       0x01
+#define HEAPTAG_FAST         0x02  // tightly coupled or zero wait state RAM
+#define HEAPTAG_LARGE        0x04  // external or big memory (e.g. SDRAM)
+#define HEAPTAG_DMA          0x08  // DMA accessible (not every DMA can reach the TCM)
+
+#define TLSF_ALIGN_SHIFT     3                       // 8 byte alignment
+#define TLSF_ALIGN           (1 << TLSF_ALIGN_SHIFT)
+#define TLSF_SL_SHIFT        3                       // 8 second level lists per first level
+#define TLSF_SL_COUNT        (1 << TLSF_SL_SHIFT)
+#define TLSF_FL_SHIFT        (TLSF_SL_SHIFT + TLSF_ALIGN_SHIFT)
+#define TLSF_SMALL_BLOCK     (1 << TLSF_FL_SHIFT)    // below this the first level is 0
+#define TLSF_FL_MAX          28                      // maximal block size: 512 MByte
+#define TLSF_FL_COUNT        (TLSF_FL_MAX - TLSF_FL_SHIFT + 2)
+
+class TTlsfBlock
+{
+public:
+	TTlsfBlock *       prev_phys;  // the physically preceding block
+	uint32_t           size;       // bit0 = free flag, data size without the header
+	// the following fields are valid only for the free blocks (they are in the user data area)
+	TTlsfBlock *       next_free;
+	TTlsfBlock *       prev_free;
+};
+
+#define TLSF_HEADER_SIZE     8     // the prev_phys and the size
+#define TLSF_MIN_BLOCK       8     // for the free list pointers
+
+class TTlsfStats
+{
+public:
+	unsigned           totalbytes = 0;
+	unsigned           usedbytes = 0;     // with headers
+	unsigned           peakusedbytes = 0; // high-water mark
+	unsigned           freebytes = 0;
+	unsigned           largestfree = 0;   // the largest allocatable block
+	unsigned           freeblocks = 0;
+	unsigned           fragmentation = 0; // in percent: 100 - largestfree * 100 / freebytes
+	unsigned           alloccount = 0;
+	unsigned           failcount = 0;
+};
+
+class TTlsfRegion
+{
+public:
+	uint8_t *          startaddr = nullptr;
+	uint8_t *          endaddr = nullptr;
+	unsigned           tag = 0;
+
+	unsigned           totalbytes = 0;
+	unsigned           usedbytes = 0;
+	unsigned           peakusedbytes = 0;
+	unsigned           alloccount = 0;
+	unsigned           failcount = 0;
+
+	bool               Init(void * aaddr, unsigned asize, unsigned atag);
+
+	void *             Alloc(unsigned asize);
+	void *             AllocAligned(unsigned asize, unsigned aalign);  // aalign must be power of 2
+	void               Free(void * aptr);
+
+	unsigned           MaxAllocSize();            // O(1) estimation, the allocation of this size always succeeds
+	void               GetStats(TTlsfStats * astats); // walks the blocks, not for time critical code
+
+	inline bool        Contains(void * aptr) { return ((uint8_t *)aptr >= startaddr) && ((uint8_t *)aptr < endaddr); }
+
+protected:
+	uint32_t           fl_bitmap = 0;
+	uint32_t           sl_bitmap[TLSF_FL_COUNT] = {};
+	TTlsfBlock *       freelist[TLSF_FL_COUNT][TLSF_SL_COUNT] = {};
+
+	void               InsertFree(TTlsfBlock * ablock);
+	void               RemoveFree(TTlsfBlock * ablock);
+};
+
+class TTlsfHeap
+{
+public:
+	unsigned           regioncount = 0;
+	TTlsfRegion        regions[TLSF_MAX_REGIONS];
+
+	bool               AddRegion(void * aaddr, unsigned asize, unsigned atag);
+
+	void *             Alloc(unsigned asize, unsigned atags = HEAPTAG_NORMAL, bool astrict = false);
+	void *             AllocAligned(unsigned asize, unsigned aalign, unsigned atags = HEAPTAG_NORMAL, bool astrict = false);
+	void *             Realloc(void * aptr, unsigned asize);
+	void               Free(void * aptr);
+
+	unsigned           BlockSize(void * aptr);  // usable size of an allocated block
+
+	void               GetStats(TTlsfStats * astats, unsigned atags = 0xFFFFFFFF);  // sums the regions with matching tags
+
+	TTlsfRegion *      FindRegion(void * aptr);
+};
+
+extern TTlsfHeap  tlsfheap;
+
+#endif /* TLSFHEAP_H_ */
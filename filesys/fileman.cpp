@@ -57,6 +57,13 @@ void TFileManager::ReleaseFileObj(TFile * afile)
 			afile->allocated_on_heap = false; // prevents also double free
 			delete afile;
 		}
+		else if (afile->ownerpool)
+		{
+			TObjectPoolBase * pool = afile->ownerpool;
+			afile->ownerpool = nullptr;
+			afile->~TFile();
+			pool->FreeRaw(afile);
+		}
 	}
 }
 
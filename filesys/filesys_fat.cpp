@@ -49,6 +49,7 @@ TFileFat::TFileFat(TFileSysFat * afilesys)
 TFile * TFileSysFat::NewFileObj(void * astorage, unsigned astoragesize)
 {
 	TFile * result = nullptr;
+	void *  pstorage = nullptr;
 	if (astorage)
 	{
 		if (astoragesize < sizeof(TFileFat))
@@ -71,6 +72,11 @@ TFile * TFileSysFat::NewFileObj(void * astorage, unsigned astoragesize)
 
     result = new ((TFileFat *)pfile) TFileFat(this);
     result->allocated_on_heap = false;
+	}
+	else if (filepool && (filepool->objsize >= sizeof(TFileFat)) && (pstorage = filepool->AllocRaw()))
+	{
+    result = new ((TFileFat *)pstorage) TFileFat(this);
+    result->ownerpool = filepool;
 	}
 	else
 	{
@@ -32,6 +32,7 @@
 #include "stdint.h"
 #include "filesystem_types.h"
 #include "stormanager.h"
+#include "objpool.h"
 
 #ifndef FILESYS_MAX_FSYS
   #define FILESYS_MAX_FSYS  4
@@ -128,6 +129,7 @@ class TFile : public TFsTransaction
 public:
 	bool             opened = false;
 	bool             allocated_on_heap = false;
+	TObjectPoolBase * ownerpool = nullptr;  // allocated from this pool
 	bool             directory = false;  // false = normal file, true = direcotry mode
 	uint32_t         open_flags = 0;
 
@@ -169,6 +171,8 @@ public:
 	uint64_t         firstaddr = 0;
 	uint64_t         maxsize = 0;
 
+	TObjectPoolBase * filepool = nullptr;  // optional, NewFileObj() without storage allocates here first
+
 public:
 	uint32_t         clusterbytes = 0;
 	uint64_t         rootdirstart = 0;
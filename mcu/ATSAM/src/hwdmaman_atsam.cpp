@@ -0,0 +1,127 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwdmaman_atsam.cpp
+ *  brief:    ATSAM XDMAC channel allocator
+ *  version:  1.00
+ *  date:     2021-08-11
+ *  authors:  nvitya
+*/
+
+#include "platform.h"
+
+#if defined(XDMAC)
+
+#include "hwdmaman.h"
+
+// XDMAC peripheral connections (SAM E70 / S70 / V7x)
+
+static const TDmaRqMap dmarqmap[] =
+{
+	{ DMARQ_SDCARD,           0 },  // HSMCI
+	{ DMARQ_SPI_TX(0),        1 },
+	{ DMARQ_SPI_RX(0),        2 },
+	{ DMARQ_SPI_TX(1),        3 },
+	{ DMARQ_SPI_RX(1),        4 },
+	{ DMARQ_QSPI_TX,          5 },
+	{ DMARQ_QSPI_RX,          6 },
+	{ DMARQ_UART_TX(0x100),   7 },  // USART0
+	{ DMARQ_UART_RX(0x100),   8 },
+	{ DMARQ_UART_TX(0x101),   9 },
+	{ DMARQ_UART_RX(0x101),  10 },
+	{ DMARQ_UART_TX(0x102),  11 },
+	{ DMARQ_UART_RX(0x102),  12 },
+	{ DMARQ_SPI_TX(0x100),    7 },  // USART0 in SPI mode
+	{ DMARQ_SPI_RX(0x100),    8 },
+	{ DMARQ_SPI_TX(0x101),    9 },
+	{ DMARQ_SPI_RX(0x101),   10 },
+	{ DMARQ_SPI_TX(0x102),   11 },
+	{ DMARQ_SPI_RX(0x102),   12 },
+	{ DMARQ_I2C_TX(0),       14 },  // TWIHS0
+	{ DMARQ_I2C_RX(0),       15 },
+	{ DMARQ_I2C_TX(1),       16 },
+	{ DMARQ_I2C_RX(1),       17 },
+	{ DMARQ_I2C_TX(2),       18 },
+	{ DMARQ_I2C_RX(2),       19 },
+	{ DMARQ_UART_TX(0),      20 },
+	{ DMARQ_UART_RX(0),      21 },
+	{ DMARQ_UART_TX(1),      22 },
+	{ DMARQ_UART_RX(1),      23 },
+	{ DMARQ_UART_TX(2),      24 },
+	{ DMARQ_UART_RX(2),      25 },
+	{ DMARQ_UART_TX(3),      26 },
+	{ DMARQ_UART_RX(3),      27 },
+	{ DMARQ_UART_TX(4),      28 },
+	{ DMARQ_UART_RX(4),      29 },
+	{ DMARQ_DAC(0),          30 },
+	{ DMARQ_DAC(1),          31 },
+	{ DMARQ_ADC(0),          35 },  // AFEC0
+	{ DMARQ_ADC(1),          36 },  // AFEC1
+	{ 0, 0 }
+};
+
+bool THwDmaManager_atsam::AllocChannel(THwDmaChannel * ach, unsigned arequest, int apriority)
+{
+	const TDmaRqMap * pmap = &dmarqmap[0];
+	while (pmap->request && (pmap->request != arequest))
+	{
+		++pmap;
+	}
+
+	if (!pmap->request)
+	{
+		return false;  // unknown request
+	}
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	int ch = FindFree(0, (1u << XDMACCHID_NUMBER) - 1, apriority);
+	if (ch >= 0)
+	{
+		usedmask[0] |= (1u << ch);
+	}
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+
+	if (ch < 0)
+	{
+		return false;
+	}
+
+	ach->priority = apriority;
+	if (!ach->Init(ch, pmap->perid))
+	{
+		Release(0, ch);  // do not leak the reserved channel
+		return false;
+	}
+
+	return true;
+}
+
+void THwDmaManager_atsam::FreeChannel(THwDmaChannel * ach)
+{
+	ach->Disable();
+	Release(0, ach->chnum);
+	ach->initialized = false;
+}
+
+#endif
@@ -0,0 +1,55 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwdmaman_atsam.h
+ *  brief:    ATSAM XDMAC channel allocator
+ *  version:  1.00
+ *  date:     2021-08-11
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    Any XDMAC channel can serve any peripheral, only the peripheral ID (PERID) is looked up.
+ *    The device numbers are the same as in the driver Init(), e.g. USART1 = DMARQ_UART_TX(0x101)
+*/
+
+#ifndef HWDMAMAN_ATSAM_H_
+#define HWDMAMAN_ATSAM_H_
+
+#define HWDMAMAN_PRE_ONLY
+#include "hwdmaman.h"
+
+typedef struct TDmaRqMap
+{
+	uint16_t   request;   // DMARQ_...
+	uint8_t    perid;     // XDMAC peripheral ID
+//
+} TDmaRqMap;
+
+class THwDmaManager_atsam : public THwDmaManager_pre
+{
+public:
+	bool AllocChannel(THwDmaChannel * ach, unsigned arequest, int apriority);
+	void FreeChannel(THwDmaChannel * ach);
+};
+
+#define HWDMAMAN_IMPL  THwDmaManager_atsam
+
+#endif // def HWDMAMAN_ATSAM_H_
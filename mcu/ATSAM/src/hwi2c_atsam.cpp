@@ -316,7 +316,7 @@ void THwI2c_atsam::Run()
 		return;
 	}
 
-	busy = false;
+	TransferFinished(); // busy = false, might start the next transfer
 }
 
 #ifdef HW_HAS_PDMA
@@ -0,0 +1,75 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwlowpower_atsam.cpp
+ *  brief:    ATSAM Low Power Modes
+ *  version:  1.00
+ *  date:     2021-08-14
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    The Wait mode is entered with the CKGR_MOR.WAITMODE bit (ATSAM3X: PMC_FSMR.LPM + WFE). Only the fast startup
+ *    inputs (PMC_FSMR / PMC_FSPR: WKUP pins, RTC / RTT alarm, USB) can wake it up, the normal IRQs not.
+ *    The master clock must run from the fast RC oscillator before entering the Wait mode.
+*/
+
+#include "platform.h"
+#include "hwlowpower.h"
+#include "hwclkctrl.h"
+
+#ifndef CKGR_MOR_KEY_PASSWD
+  #define CKGR_MOR_KEY_PASSWD CKGR_MOR_KEY(0x37)
+#endif
+
+void THwLowPower_atsam::EnterDeepSleep()
+{
+	uint32_t mor = (PMC->CKGR_MOR & ~CKGR_MOR_KEY_Msk);
+
+	// master clock from the main clock, the PLL can not be used in Wait mode
+	PMC->PMC_MCKR = (PMC->PMC_MCKR & ~PMC_MCKR_CSS_Msk) | PMC_MCKR_CSS_MAIN_CLK;
+	while (!(PMC->PMC_SR & PMC_SR_MCKRDY))
+	{
+	}
+
+	// main clock from the fast RC oscillator
+	mor = (mor & ~CKGR_MOR_MOSCSEL) | CKGR_MOR_MOSCRCEN;
+	PMC->CKGR_MOR = CKGR_MOR_KEY_PASSWD | mor;
+	while (!(PMC->PMC_SR & PMC_SR_MOSCSELS))
+	{
+	}
+
+#if defined(CKGR_MOR_WAITMODE)
+	PMC->CKGR_MOR = CKGR_MOR_KEY_PASSWD | mor | CKGR_MOR_WAITMODE;
+	while (!(PMC->PMC_SR & PMC_SR_MCKRDY))
+	{
+	}
+#else // ATSAM3X: Wait mode with WFE
+	PMC->PMC_FSMR |= PMC_FSMR_LPM;
+	__DSB();
+	__WFE();
+	PMC->PMC_FSMR &= ~PMC_FSMR_LPM;
+#endif
+}
+
+void THwLowPower_atsam::RestoreAfterDeepSleep()
+{
+	hwclkctrl.RestoreCpuClock();
+}
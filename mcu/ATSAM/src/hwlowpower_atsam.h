@@ -0,0 +1,46 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwlowpower_atsam.h
+ *  brief:    ATSAM Low Power Modes
+ *  version:  1.00
+ *  date:     2021-08-14
+ *  authors:  nvitya
+*/
+
+#ifndef HWLOWPOWER_ATSAM_H_
+#define HWLOWPOWER_ATSAM_H_
+
+#define HWLOWPOWER_PRE_ONLY
+#include "hwlowpower.h"
+
+class THwLowPower_atsam : public THwLowPower_pre
+{
+public:
+	bool DeepSleepSupported()  { return true; }
+
+	void EnterDeepSleep();         // Wait mode
+	void RestoreAfterDeepSleep();
+};
+
+#define HWLOWPOWER_IMPL   THwLowPower_atsam
+
+#endif // def HWLOWPOWER_ATSAM_H_
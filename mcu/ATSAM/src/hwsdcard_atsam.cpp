@@ -28,6 +28,7 @@
 
 #include "platform.h"
 #include "hwsdcard.h"
+#include "errors.h"
 #include "atsam_utils.h"
 #include "clockcnt.h"
 
@@ -146,6 +147,15 @@ void THwSdcard_atsam::SetSpeed(uint32_t speed)
 	regs->HSMCI_MR |= HSMCI_MR_CLKDIV(clkdiv);
 #endif
 
+	// the high speed flag is set by the initialization after the CMD6 switch
+	if (high_speed)
+	{
+		regs->HSMCI_CFG |= HSMCI_CFG_HSMODE;
+	}
+	else
+	{
+		regs->HSMCI_CFG &= ~HSMCI_CFG_HSMODE;
+	}
 }
 
 void THwSdcard_atsam::SetBusWidth(uint8_t abuswidth)
@@ -446,6 +456,17 @@ void THwSdcard_atsam::RunTransfer()
 			trstate = 0; // transfer finished.
 		}
 		break;
+
+	case 11: // write blocks
+	case 21: // open stream
+	case 31: // continue stream
+	case 41: // close stream
+		// the write path is not implemented for the HSMCI yet
+		errorcode = ERROR_NOTIMPL;
+		stream_open = false;
+		completed = true;
+		trstate = 0;
+		break;
 	}
 }
 
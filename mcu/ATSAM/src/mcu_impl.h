@@ -42,6 +42,10 @@
   #include "hwdma_atsam.h"
 #endif
 
+#if defined(HWDMAMAN_H_) && defined(XDMAC)
+  #include "hwdmaman_atsam.h"
+#endif
+
 #ifdef HWEXTIRQ_H_
   #include "hwextirq_atsam.h"
 #endif
@@ -92,3 +96,7 @@
 #if defined(SDRAMC) && defined(HWSDRAM_H_)
   #include "hwsdram_atsam.h"
 #endif
+
+#ifdef HWLOWPOWER_H_
+  #include "hwlowpower_atsam.h"
+#endif
@@ -516,8 +516,8 @@ void THwI2c_atsam_v2::Run()
 			return;
 		}
 
-		busy = false; // finished.
 		runstate = 50;
+		TransferFinished(); // busy = false, might start the next transfer
 	  break;
 
 	case 50: // finished
@@ -542,8 +542,8 @@ void THwI2c_atsam_v2::Run()
 		{
 			return;
 		}
-		busy = false; // finished.
 		runstate = 50;
+		TransferFinished(); // busy = false, might start the next transfer
 		break;
 
 	} // case
@@ -53,3 +53,7 @@
 #ifdef HWQSPI_H_
   #include "hwqspi_lpc.h"
 #endif
+
+#ifdef HWLOWPOWER_H_
+  #include "hwlowpower_lpc.h"
+#endif
@@ -82,12 +82,8 @@ void THwDmaChannel_lpc_v3::Prepare(bool aistx, void * aperiphaddr, unsigned afla
 	Enable();
 }
 
-bool THwDmaChannel_lpc_v3::PrepareTransfer(THwDmaTransfer * axfer)
+unsigned THwDmaChannel_lpc_v3::CalcDescriptor(THwDmaTransfer * axfer, TDmaDesc * adesc)
 {
-	Disable();
-
-	HW_DMA->ERRINT = (1 << chnum); // clear error
-
 	register unsigned cntm1 = axfer->count - 1;
 	register unsigned bytewidth = axfer->bytewidth;
 
@@ -115,39 +111,105 @@ bool THwDmaChannel_lpc_v3::PrepareTransfer(THwDmaTransfer * axfer)
 		xfercfg |= (1 << 8);
 	}
 
+	if (axfer->flags & DMATR_IRQ)
+	{
+		xfercfg |= (1 << 4); // SETINTA
+	}
+
 	if (istx)
 	{
 		if ((axfer->flags & DMATR_NO_ADDR_INC) == 0)
 		{
 			xfercfg |= (1 << 12); // SRC increment with the given width
-			firstdesc->SRCEND = (char *)(unsigned(axfer->srcaddr) + cntm1 * bytewidth);
+			adesc->SRCEND = (char *)(unsigned(axfer->srcaddr) + cntm1 * bytewidth);
 		}
 		else
 		{
-			firstdesc->SRCEND = (char *)(unsigned(axfer->srcaddr));
+			adesc->SRCEND = (char *)(unsigned(axfer->srcaddr));
 		}
 
-		firstdesc->DSTEND = periphaddr;
+		adesc->DSTEND = periphaddr;
 	}
 	else
 	{
 		if ((axfer->flags & DMATR_NO_ADDR_INC) == 0)
 		{
 			xfercfg |= (1 << 14); // DST increment with the given width
-			firstdesc->DSTEND = (char *)(unsigned(axfer->dstaddr) + cntm1 * bytewidth);
+			adesc->DSTEND = (char *)(unsigned(axfer->dstaddr) + cntm1 * bytewidth);
 		}
 		else
 		{
-			firstdesc->DSTEND = (char *)(unsigned(axfer->dstaddr));
+			adesc->DSTEND = (char *)(unsigned(axfer->dstaddr));
 		}
 
-		firstdesc->SRCEND = periphaddr;
+		adesc->SRCEND = periphaddr;
 	}
 
-	firstdesc->NEXT = nullptr;
+	adesc->NEXT = nullptr;
+
+	return xfercfg;
+}
+
+bool THwDmaChannel_lpc_v3::PrepareTransfer(THwDmaTransfer * axfer)
+{
+	Disable();
+
+	HW_DMA->ERRINT = (1 << chnum); // clear error
 
 	//regs->CTLSTAT = 0;
-	regs->XFERCFG = xfercfg;
+	regs->XFERCFG = CalcDescriptor(axfer, firstdesc);
+
+	return true;
+}
+
+bool THwDmaChannel_lpc_v3::PrepareChain(THwDmaTransfer * afirst)
+{
+	// count the items, the chain might point back to the first item
+	unsigned itemcnt = 0;
+	THwDmaTransfer * xfer = afirst;
+	while (xfer)
+	{
+		if (xfer->count > HW_DMA_MAX_COUNT)
+		{
+			return false; // software chunking required
+		}
+		++itemcnt;
+		xfer = xfer->next;
+		if (xfer == afirst)
+		{
+			break;
+		}
+	}
+
+	if (!chaindesc || (itemcnt > chaindesccount))
+	{
+		return false;
+	}
+
+	Disable();
+
+	HW_DMA->ERRINT = (1 << chnum); // clear error
+
+	// every item gets a full descriptor, because the first one in the channel table has no XFERCFG
+
+	xfer = afirst;
+	for (unsigned n = 0; n < itemcnt; ++n)
+	{
+		TDmaDesc * pdesc = &chaindesc[n];
+		pdesc->XFERCFG = CalcDescriptor(xfer, pdesc);
+		if (xfer->next)
+		{
+			pdesc->XFERCFG |= (1 << 1); // RELOAD
+			pdesc->NEXT = ((n + 1 < itemcnt) ? &chaindesc[n + 1] : &chaindesc[0]);
+		}
+		xfer = xfer->next;
+	}
+
+	firstdesc->SRCEND = chaindesc[0].SRCEND;
+	firstdesc->DSTEND = chaindesc[0].DSTEND;
+	firstdesc->NEXT   = chaindesc[0].NEXT;
+
+	regs->XFERCFG = chaindesc[0].XFERCFG;
 
 	return true;
 }
@@ -102,6 +102,8 @@ typedef struct TDmaRegs
 #define HW_DMA       ((TDmaRegs *)DMA0_BASE)
 #define HW_DMA_REGS  TDmaChRegs
 
+#define HWDMA_NATIVE_CHAIN  // linked descriptors with the RELOAD bit
+
 class THwDmaChannel_lpc_v3 : public THwDmaChannel_pre
 {
 public:
@@ -123,6 +125,15 @@ public:
 
 	bool PrepareTransfer(THwDmaTransfer * axfer);
 	inline void StartPreparedTransfer() { Enable(); }
+
+public: // descriptor chains
+	TDmaDesc *         chaindesc = nullptr;   // user provided descriptor array (16 byte aligned), one for every chain item
+	unsigned           chaindesccount = 0;
+
+	bool PrepareChain(THwDmaTransfer * afirst);  // returns false when there are not enough descriptors
+
+protected:
+	unsigned CalcDescriptor(THwDmaTransfer * axfer, TDmaDesc * adesc);  // sets the SRCEND, DSTEND, returns the XFERCFG
 };
 
 #define HWDMACHANNEL_IMPL  THwDmaChannel_lpc_v3
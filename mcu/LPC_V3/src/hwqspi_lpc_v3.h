@@ -46,6 +46,8 @@ public:
 
 	int  StartReadData(unsigned acmd, unsigned address, void * dstptr, unsigned len);
 	int  StartWriteData(unsigned acmd, unsigned address, void * srcptr, unsigned len);
+	bool SetMemMappedMode(unsigned acmd, bool acontinuous) { return false; }  // not implemented yet
+	void SetIndirectMode() { }
 	void Run();
 
 	unsigned       ctrlbase = 0;
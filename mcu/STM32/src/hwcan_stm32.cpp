@@ -41,7 +41,6 @@
 
 bool THwCan_stm32::HwInit(int adevnum)
 {
-	uint8_t busid = STM32_BUSID_APB1;
 	uint32_t tmp;
 
 	if (false)  { }
@@ -100,9 +99,46 @@ bool THwCan_stm32::HwInit(int adevnum)
 		| (1 <<  0)   // INRQ: initialization request
 	;
 
-	// set speed
+	SetSpeed(speed);
 
-	uint32_t periphclock = stm32_bus_speed(busid);
+	// setup filtering
+
+	regs->FMR = 1;  // set filter initialization mode
+
+	regs->FM1R = 0; // set ID+MASK mode
+	regs->FS1R = 0; // set dual (16 bit scale) mode: 2 entries per filter bank
+	regs->FFA1R = 0; // assign all filters to the FIFO1
+
+	regs->FA1R = 0;  // disable all filters for now
+
+	return true;
+}
+
+void THwCan_stm32::Enable()
+{
+	regs->MCR &= ~CAN_MCR_INRQ;
+	while (regs->MSR & CAN_MSR_INAK) { } // wait until leaves inactive mode
+
+	regs->FMR = 0; // enable filters
+}
+
+void THwCan_stm32::Disable()
+{
+	regs->MCR |= CAN_MCR_INRQ; // request inactive mode
+	while (!(regs->MSR & CAN_MSR_INAK)) { } // wait until it enters inactive mode
+}
+
+void THwCan_stm32::SetSpeed(uint32_t aspeed)
+{
+	bool wasenabled = Enabled();
+	if (wasenabled)
+	{
+		Disable();
+	}
+
+	speed = aspeed;
+
+	uint32_t periphclock = stm32_bus_speed(STM32_BUSID_APB1);  // all bxCAN units are on the APB1
 
 	uint32_t brp = 1;
 	uint32_t ts1, ts2;
@@ -135,25 +171,12 @@ bool THwCan_stm32::HwInit(int adevnum)
 	  | ((brp - 1) <<  0)  // BRP(10): Baud rate prescaler
 	;
 
-	// setup filtering
+  canbitcpuclocks = SystemCoreClock / speed;
 
-	regs->FMR = 1;  // set filter initialization mode
-
-	regs->FM1R = 0; // set ID+MASK mode
-	regs->FS1R = 0; // set dual (16 bit scale) mode: 2 entries per filter bank
-	regs->FFA1R = 0; // assign all filters to the FIFO1
-
-	regs->FA1R = 0;  // disable all filters for now
-
-	return true;
-}
-
-void THwCan_stm32::Enable()
-{
-	regs->MCR &= ~CAN_MCR_INRQ;
-	while (regs->MSR & CAN_MSR_INAK) { } // wait until leaves inactive mode
-
-	regs->FMR = 0; // enable filters
+	if (wasenabled)
+	{
+		Enable();
+	}
 }
 
 void THwCan_stm32::HandleTx()
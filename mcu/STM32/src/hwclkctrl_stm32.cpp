@@ -592,6 +592,13 @@ void THwClkCtrl_stm32::PrepareHiSpeed(unsigned acpuspeed)
 
 bool THwClkCtrl_stm32::SetupPlls(bool aextosc, unsigned abasespeed, unsigned acpuspeed)
 {
+	// select the HSI as clock source, the PLL might be running (speed change)
+  RCC->CFGR &= ~3;
+  RCC->CFGR |= RCC_CFGR_SW_HSI;
+  while (((RCC->CFGR >> 2) & 3) != RCC_CFGR_SW_HSI) // wait until it is set
+  {
+  }
+
 	RCC->CR &= ~RCC_CR_PLLON;  // disable the PLL
 
   /* Wait till PLL is not ready */
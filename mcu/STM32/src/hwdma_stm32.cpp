@@ -283,6 +283,13 @@ void THwDmaChannel_stm32::PrepareTransfer(THwDmaTransfer * axfer)
 	else if (axfer->bytewidth == 4)  sizecode = 2;
 
 	int meminc = (axfer->flags & DMATR_NO_ADDR_INC ? 0 : 1);
+	int perinc = 0;
+	if (axfer->flags & DMATR_MEM_TO_MEM)
+	{
+		// the source is on the peripheral side
+		perinc = (axfer->flags & DMATR_NO_SRC_INC ? 0 : 1);
+		meminc = (axfer->flags & DMATR_NO_DST_INC ? 0 : 1);
+	}
 
 	uint32_t circ = (axfer->flags & DMATR_CIRCULAR ? 1 : 0);
 	uint32_t inte = (axfer->flags & DMATR_IRQ ? 1 : 0);
@@ -298,7 +305,7 @@ void THwDmaChannel_stm32::PrepareTransfer(THwDmaTransfer * axfer)
 		| (sizecode << 10)  // MSIZE(2): Memory data size, 8 bit
 		| (sizecode <<  8)  // PSIZE(2): Periph data size, 8 bit
 		| (meminc   <<  7)  // MINC: Memory increment mode
-		| (0  <<  6)        // PINC: Peripheral increment mode
+		| (perinc   <<  6)  // PINC: Peripheral increment mode
 		| (circ <<  5)      // CIRC: Circular mode
 		| (dircode <<  4)   // DIR(2): Data transfer direction (init with 0)
 		| (0 <<  3)         // TEIE: Transfer error interrupt enable
@@ -353,7 +360,7 @@ void THwDmaChannel_stm32::PrepareTransfer(THwDmaTransfer * axfer)
 		| (sizecode << 13)  // MSIZE(2): Memory data size, 8 bit
 		| (sizecode << 11)  // PSIZE(2): Periph data size, 8 bit
 		| (meminc   << 10)  // MINC: Memory increment mode
-		| (0  <<  9)        // PINC: Peripheral increment mode
+		| (perinc   <<  9)  // PINC: Peripheral increment mode
 		| (circ <<  8)      // CIRC: Circular mode
 		| (dircode <<  6)   // DIR(2): Data transfer direction (init with 0)
 		| (per_flow_controller <<  5)        // PFCTRL: Peripheral flow controller, 0 = DMA is the flow controller
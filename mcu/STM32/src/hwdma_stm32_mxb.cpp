@@ -207,6 +207,13 @@ void THwDmaChannel_stm32::PrepareTransfer(THwDmaTransfer * axfer)
 	}
 
 	int meminc = (axfer->flags & DMATR_NO_ADDR_INC ? 0 : 1);
+	int perinc = 0;
+	if (axfer->flags & DMATR_MEM_TO_MEM)
+	{
+		// the source is on the peripheral side
+		perinc = (axfer->flags & DMATR_NO_SRC_INC ? 0 : 1);
+		meminc = (axfer->flags & DMATR_NO_DST_INC ? 0 : 1);
+	}
 
 	uint32_t circ = (axfer->flags & DMATR_CIRCULAR ? 1 : 0);
 	uint32_t inte = (axfer->flags & DMATR_IRQ ? 1 : 0);
@@ -227,8 +234,8 @@ void THwDmaChannel_stm32::PrepareTransfer(THwDmaTransfer * axfer)
 			mregs->CDAR = (uint32_t)axfer->dstaddr;
 			sbus = get_busid_by_address(axfer->srcaddr);
 			dbus = get_busid_by_address(axfer->dstaddr);
-			sinc = 2;
-			dinc = 2;
+			sinc = (perinc << 1);
+			dinc = (meminc << 1);
 		}
 		else if (istx)
 		{
@@ -307,7 +314,7 @@ void THwDmaChannel_stm32::PrepareTransfer(THwDmaTransfer * axfer)
 				| (sizecode << 13)  // MSIZE(2): Memory data size, 8 bit
 				| (sizecode << 11)  // PSIZE(2): Periph data size, 8 bit
 				| (meminc   << 10)  // MINC: Memory increment mode
-				| (0  <<  9)        // PINC: Peripheral increment mode
+				| (perinc   <<  9)  // PINC: Peripheral increment mode
 				| (circ <<  8)      // CIRC: Circular mode
 				| (dircode <<  6)   // DIR(2): Data transfer direction
 				| (per_flow_controller  <<  5)        // PFCTRL: Peripheral flow controller, 0 = DMA is the flow controller
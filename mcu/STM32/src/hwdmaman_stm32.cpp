@@ -0,0 +1,319 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwdmaman_stm32.cpp
+ *  brief:    STM32 DMA channel allocator
+ *  version:  1.00
+ *  date:     2021-08-11
+ *  authors:  nvitya
+*/
+
+#include "platform.h"
+#include "hwdmaman.h"
+
+#if defined(MCUSF_G4)
+
+#define HWDMAMAN_DMAMUX
+
+#ifdef DMA1_Channel8
+  #define HWDMAMAN_CHMASK  0x1FE  // channels 1..8
+#else
+  #define HWDMAMAN_CHMASK  0x07E  // channels 1..6
+#endif
+
+static const TDmaRqMap dmarqmap[] =
+{
+	{ DMARQ_ADC(1),       0, 0,  5 },
+	{ DMARQ_DAC(1),       0, 0,  6 },
+	{ DMARQ_SPI_RX(1),    0, 0, 10 },
+	{ DMARQ_SPI_TX(1),    0, 0, 11 },
+	{ DMARQ_SPI_RX(2),    0, 0, 12 },
+	{ DMARQ_SPI_TX(2),    0, 0, 13 },
+	{ DMARQ_SPI_RX(3),    0, 0, 14 },
+	{ DMARQ_SPI_TX(3),    0, 0, 15 },
+	{ DMARQ_I2C_RX(1),    0, 0, 16 },
+	{ DMARQ_I2C_TX(1),    0, 0, 17 },
+	{ DMARQ_I2C_RX(2),    0, 0, 18 },
+	{ DMARQ_I2C_TX(2),    0, 0, 19 },
+	{ DMARQ_I2C_RX(3),    0, 0, 20 },
+	{ DMARQ_I2C_TX(3),    0, 0, 21 },
+	{ DMARQ_I2C_RX(4),    0, 0, 22 },
+	{ DMARQ_I2C_TX(4),    0, 0, 23 },
+	{ DMARQ_UART_RX(1),   0, 0, 24 },
+	{ DMARQ_UART_TX(1),   0, 0, 25 },
+	{ DMARQ_UART_RX(2),   0, 0, 26 },
+	{ DMARQ_UART_TX(2),   0, 0, 27 },
+	{ DMARQ_UART_RX(3),   0, 0, 28 },
+	{ DMARQ_UART_TX(3),   0, 0, 29 },
+	{ DMARQ_UART_RX(4),   0, 0, 30 },
+	{ DMARQ_UART_TX(4),   0, 0, 31 },
+	{ DMARQ_UART_RX(5),   0, 0, 32 },
+	{ DMARQ_UART_TX(5),   0, 0, 33 },
+	{ DMARQ_ADC(2),       0, 0, 36 },
+	{ DMARQ_ADC(3),       0, 0, 37 },
+	{ DMARQ_ADC(4),       0, 0, 38 },
+	{ DMARQ_ADC(5),       0, 0, 39 },
+	{ DMARQ_QSPI_TX,      0, 0, 40 },
+	{ DMARQ_QSPI_RX,      0, 0, 40 },
+	{ 0, 0, 0, 0 }
+};
+
+#elif defined(MCUSF_H7)
+
+#define HWDMAMAN_DMAMUX
+#define HWDMAMAN_CHMASK  0x0FF  // streams 0..7
+
+static const TDmaRqMap dmarqmap[] =
+{
+	{ DMARQ_ADC(1),       0, 0,   9 },
+	{ DMARQ_ADC(2),       0, 0,  10 },
+	{ DMARQ_I2C_RX(1),    0, 0,  33 },
+	{ DMARQ_I2C_TX(1),    0, 0,  34 },
+	{ DMARQ_I2C_RX(2),    0, 0,  35 },
+	{ DMARQ_I2C_TX(2),    0, 0,  36 },
+	{ DMARQ_SPI_RX(1),    0, 0,  37 },
+	{ DMARQ_SPI_TX(1),    0, 0,  38 },
+	{ DMARQ_SPI_RX(2),    0, 0,  39 },
+	{ DMARQ_SPI_TX(2),    0, 0,  40 },
+	{ DMARQ_UART_RX(1),   0, 0,  41 },
+	{ DMARQ_UART_TX(1),   0, 0,  42 },
+	{ DMARQ_UART_RX(2),   0, 0,  43 },
+	{ DMARQ_UART_TX(2),   0, 0,  44 },
+	{ DMARQ_UART_RX(3),   0, 0,  45 },
+	{ DMARQ_UART_TX(3),   0, 0,  46 },
+	{ DMARQ_SPI_RX(3),    0, 0,  61 },
+	{ DMARQ_SPI_TX(3),    0, 0,  62 },
+	{ DMARQ_UART_RX(4),   0, 0,  63 },
+	{ DMARQ_UART_TX(4),   0, 0,  64 },
+	{ DMARQ_UART_RX(5),   0, 0,  65 },
+	{ DMARQ_UART_TX(5),   0, 0,  66 },
+	{ DMARQ_DAC(1),       0, 0,  67 },
+	{ DMARQ_DAC(2),       0, 0,  68 },
+	{ DMARQ_UART_RX(6),   0, 0,  71 },
+	{ DMARQ_UART_TX(6),   0, 0,  72 },
+	{ DMARQ_I2C_RX(3),    0, 0,  73 },
+	{ DMARQ_I2C_TX(3),    0, 0,  74 },
+	{ DMARQ_SPI_RX(4),    0, 0,  83 },
+	{ DMARQ_SPI_TX(4),    0, 0,  84 },
+	{ DMARQ_SPI_RX(5),    0, 0,  85 },
+	{ DMARQ_SPI_TX(5),    0, 0,  86 },
+	{ DMARQ_ADC(3),       0, 0, 115 },
+	{ 0, 0, 0, 0 }
+};
+
+#elif defined(MCUSF_F4) || defined(MCUSF_F7)
+
+// DMA request mapping (RM0090 / RM0410), multiple lines for the alternatives
+
+static const TDmaRqMap dmarqmap[] =
+{
+	// DMA1
+	{ DMARQ_SPI_RX(3),    1, 0, 0 },
+	{ DMARQ_SPI_RX(3),    1, 2, 0 },
+	{ DMARQ_SPI_RX(2),    1, 3, 0 },
+	{ DMARQ_SPI_TX(2),    1, 4, 0 },
+	{ DMARQ_SPI_TX(3),    1, 5, 0 },
+	{ DMARQ_SPI_TX(3),    1, 7, 0 },
+	{ DMARQ_I2C_RX(1),    1, 0, 1 },
+	{ DMARQ_I2C_RX(1),    1, 5, 1 },
+	{ DMARQ_I2C_TX(1),    1, 6, 1 },
+	{ DMARQ_I2C_TX(1),    1, 7, 1 },
+	{ DMARQ_I2C_RX(3),    1, 2, 3 },
+	{ DMARQ_I2C_TX(3),    1, 4, 3 },
+	{ DMARQ_UART_RX(5),   1, 0, 4 },
+	{ DMARQ_UART_RX(3),   1, 1, 4 },
+	{ DMARQ_UART_RX(4),   1, 2, 4 },
+	{ DMARQ_UART_TX(3),   1, 3, 4 },
+	{ DMARQ_UART_TX(4),   1, 4, 4 },
+	{ DMARQ_UART_RX(2),   1, 5, 4 },
+	{ DMARQ_UART_TX(2),   1, 6, 4 },
+	{ DMARQ_UART_TX(5),   1, 7, 4 },
+	{ DMARQ_UART_TX(3),   1, 4, 7 },
+	{ DMARQ_I2C_RX(2),    1, 2, 7 },
+	{ DMARQ_I2C_RX(2),    1, 3, 7 },
+	{ DMARQ_I2C_TX(2),    1, 7, 7 },
+	{ DMARQ_DAC(1),       1, 5, 7 },
+	{ DMARQ_DAC(2),       1, 6, 7 },
+
+	// DMA2
+	{ DMARQ_ADC(1),       2, 0, 0 },
+	{ DMARQ_ADC(1),       2, 4, 0 },
+	{ DMARQ_ADC(2),       2, 2, 1 },
+	{ DMARQ_ADC(2),       2, 3, 1 },
+	{ DMARQ_ADC(3),       2, 0, 2 },
+	{ DMARQ_ADC(3),       2, 1, 2 },
+	{ DMARQ_SPI_RX(5),    2, 3, 2 },
+	{ DMARQ_SPI_TX(5),    2, 4, 2 },
+	{ DMARQ_SPI_RX(1),    2, 0, 3 },
+	{ DMARQ_SPI_RX(1),    2, 2, 3 },
+	{ DMARQ_SPI_TX(1),    2, 3, 3 },
+	{ DMARQ_SPI_TX(1),    2, 5, 3 },
+	{ DMARQ_SPI_RX(4),    2, 0, 4 },
+	{ DMARQ_SPI_TX(4),    2, 1, 4 },
+	{ DMARQ_UART_RX(1),   2, 2, 4 },
+	{ DMARQ_UART_RX(1),   2, 5, 4 },
+	{ DMARQ_UART_TX(1),   2, 7, 4 },
+	{ DMARQ_SDCARD,       2, 3, 4 },
+	{ DMARQ_SDCARD,       2, 6, 4 },
+	{ DMARQ_UART_RX(6),   2, 1, 5 },
+	{ DMARQ_UART_RX(6),   2, 2, 5 },
+	{ DMARQ_UART_TX(6),   2, 6, 5 },
+	{ DMARQ_UART_TX(6),   2, 7, 5 },
+	{ DMARQ_SPI_RX(4),    2, 3, 5 },
+	{ DMARQ_SPI_TX(4),    2, 4, 5 },
+	{ DMARQ_SPI_RX(5),    2, 5, 7 },
+	{ DMARQ_SPI_TX(5),    2, 6, 7 },
+#if defined(QUADSPI)
+	{ DMARQ_QSPI_TX,      2, 7, 3 },
+	{ DMARQ_QSPI_RX,      2, 7, 3 },
+#endif
+	{ 0, 0, 0, 0 }
+};
+
+#endif
+
+#if defined(HWDMAMAN_DMAMUX)
+
+bool THwDmaManager_stm32::AllocChannel(THwDmaChannel * ach, unsigned arequest, int apriority)
+{
+	const TDmaRqMap * pmap = &dmarqmap[0];
+	while (pmap->request && (pmap->request != arequest))
+	{
+		++pmap;
+	}
+
+	if (!pmap->request)
+	{
+		return false;  // unknown request
+	}
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	int dma = 1;
+	int ch = FindFree(dma, HWDMAMAN_CHMASK, apriority);
+	if (ch < 0)
+	{
+		dma = 2;
+		ch = FindFree(dma, HWDMAMAN_CHMASK, apriority);
+	}
+
+	if (ch >= 0)
+	{
+		usedmask[dma] |= (1u << ch);
+	}
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+
+	if (ch < 0)
+	{
+		return false;
+	}
+
+	ach->priority = apriority;
+	if (!ach->Init(dma, ch, pmap->channel))
+	{
+		Release(dma, ch);  // do not leak the reserved channel
+		return false;
+	}
+
+	return true;
+}
+
+void THwDmaManager_stm32::FreeChannel(THwDmaChannel * ach)
+{
+	ach->Disable();
+#if defined(DMASTREAMS) && !defined(HWDMA_MXB)
+	Release(ach->dmanum, ach->streamnum);
+#else
+	Release(ach->dmanum, ach->chnum);
+#endif
+	ach->initialized = false;
+}
+
+#elif defined(MCUSF_F4) || defined(MCUSF_F7)
+
+bool THwDmaManager_stm32::AllocChannel(THwDmaChannel * ach, unsigned arequest, int apriority)
+{
+	// collect the possible streams, and take the free one
+
+	const TDmaRqMap * pmap;
+	const TDmaRqMap * pfound = nullptr;
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	for (pmap = &dmarqmap[0]; pmap->request; ++pmap)
+	{
+		if ((pmap->request == arequest) && (FindFree(pmap->dma, (1u << pmap->stream), apriority) >= 0))
+		{
+			if (!pfound)
+			{
+				pfound = pmap;
+			}
+			else if ((apriority > 0) == (pmap->stream < pfound->stream))
+			{
+				pfound = pmap;  // lower stream number for high priority, higher one for low priority
+			}
+		}
+	}
+
+	if (pfound)
+	{
+		usedmask[pfound->dma] |= (1u << pfound->stream);
+	}
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+
+	if (!pfound)
+	{
+		return false;
+	}
+
+	ach->priority = apriority;
+	if (!ach->Init(pfound->dma, pfound->stream, pfound->channel))
+	{
+		Release(pfound->dma, pfound->stream);  // do not leak the reserved stream
+		return false;
+	}
+
+	return true;
+}
+
+void THwDmaManager_stm32::FreeChannel(THwDmaChannel * ach)
+{
+	ach->Disable();
+	Release(ach->dmanum, ach->streamnum);
+	ach->initialized = false;
+}
+
+#else
+
+bool THwDmaManager_stm32::AllocChannel(THwDmaChannel * ach, unsigned arequest, int apriority)
+{
+	return false;  // no request mapping for this family
+}
+
+void THwDmaManager_stm32::FreeChannel(THwDmaChannel * ach)
+{
+}
+
+#endif
@@ -0,0 +1,58 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwdmaman_stm32.h
+ *  brief:    STM32 DMA channel allocator
+ *  version:  1.00
+ *  date:     2021-08-11
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    DMAMUX devices (G4, H7): any DMA1 / DMA2 channel can serve any request, only the request ID is looked up.
+ *    Stream devices without DMAMUX (F4, F7): the fixed stream / channel matrix is used.
+ *    The other families are not supported by the allocator (the channels must be initialized directly).
+*/
+
+#ifndef HWDMAMAN_STM32_H_
+#define HWDMAMAN_STM32_H_
+
+#define HWDMAMAN_PRE_ONLY
+#include "hwdmaman.h"
+
+typedef struct TDmaRqMap
+{
+	uint16_t   request;   // DMARQ_...
+	uint8_t    dma;       // DMA controller number (DMAMUX: 0 = any)
+	uint8_t    stream;    // stream number (DMAMUX: not used)
+	uint8_t    channel;   // stream channel selection, or the DMAMUX request ID
+//
+} TDmaRqMap;
+
+class THwDmaManager_stm32 : public THwDmaManager_pre
+{
+public:
+	bool AllocChannel(THwDmaChannel * ach, unsigned arequest, int apriority);
+	void FreeChannel(THwDmaChannel * ach);
+};
+
+#define HWDMAMAN_IMPL  THwDmaManager_stm32
+
+#endif // def HWDMAMAN_STM32_H_
@@ -500,8 +500,8 @@ void THwI2c_stm32::Run()
 			return;
 		}
 
-		busy = false; // finished.
 		runstate = 50;
+		TransferFinished(); // busy = false, might start the next transfer
 	  break;
 
 	case 50: // finished
@@ -518,8 +518,8 @@ void THwI2c_stm32::Run()
 		{
 			return;
 		}
-		busy = false; // finished.
 		runstate = 50;
+		TransferFinished(); // busy = false, might start the next transfer
 		break;
 
 	} // case
@@ -626,8 +626,8 @@ void THwI2c_stm32::Run()
 
 		regs->ICR = I2C_ICR_STOPCF;
 
-		busy = false; // finished.
 		runstate = 50;
+		TransferFinished(); // busy = false, might start the next transfer
 	  break;
 
 	case 50: // finished
@@ -651,8 +651,8 @@ void THwI2c_stm32::Run()
 			return;
 		}
 		regs->ICR = I2C_ICR_STOPCF;
-		busy = false; // finished.
 		runstate = 50;
+		TransferFinished(); // busy = false, might start the next transfer
 		break;
 
 	} // case
@@ -0,0 +1,182 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwlowpower_stm32.cpp
+ *  brief:    STM32 Low Power Modes
+ *  version:  1.00
+ *  date:     2021-08-14
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    The STOP mode stops the HSE and the PLLs, the CPU wakes up with the HSI (MSI on the L0),
+ *    so the clocks must be restored. The EXTI lines (pins, RTC wake up, LPTIM) can wake up from STOP.
+ *    The LPTIM1 wake up timer uses its IRQ only for the wake up: the StopWakeupTimer() clears it before the
+ *    interrupts are enabled again, so no IRQ handler is required.
+*/
+
+#include "platform.h"
+#include "hwlowpower.h"
+#include "hwclkctrl.h"
+
+void THwLowPower_stm32::EnterDeepSleep()
+{
+	// select the STOP mode with low power regulator
+
+#if defined(PWR_CPUCR_PDDS_D1)  // H7
+	PWR->CPUCR &= ~(PWR_CPUCR_PDDS_D1 | PWR_CPUCR_PDDS_D2 | PWR_CPUCR_PDDS_D3);
+	PWR->CR1 |= PWR_CR1_LPDS;
+#elif defined(PWR_CR1_LPMS)  // G4
+	RCC->APB1ENR1 |= RCC_APB1ENR1_PWREN;
+	PWR->CR1 = (PWR->CR1 & ~PWR_CR1_LPMS) | PWR_CR1_LPMS_STOP1;
+#elif defined(PWR_CR1_PDDS)  // F7
+	RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+	PWR->CR1 = (PWR->CR1 & ~PWR_CR1_PDDS) | PWR_CR1_LPDS;
+#else // F0, F1, F3, F4, L0
+	RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+	PWR->CR = (PWR->CR & ~PWR_CR_PDDS) | PWR_CR_LPDS;
+#endif
+
+	SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+
+	__DSB();
+	__WFI();
+
+	SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+}
+
+void THwLowPower_stm32::RestoreAfterDeepSleep()
+{
+	hwclkctrl.RestoreCpuClock();
+}
+
+#ifdef HWLOWPOWER_STM32_LPTIM
+
+bool THwLowPower_stm32::StartWakeupTimer(unsigned aus)
+{
+	// select the clock: the LSE when it runs, otherwise the LSI
+
+#if defined(RCC_BDCR_LSERDY)
+	bool lse = (0 != (RCC->BDCR & RCC_BDCR_LSERDY));
+#else
+	bool lse = (0 != (RCC->CSR & RCC_CSR_LSERDY));
+#endif
+
+	if (!lse && !(RCC->CSR & RCC_CSR_LSIRDY))
+	{
+		RCC->CSR |= RCC_CSR_LSION;
+		while (0 == (RCC->CSR & RCC_CSR_LSIRDY))
+		{
+			// wait
+		}
+	}
+
+	lptim_hz = (lse ? 32768 : HWLOWPOWER_LSI_HZ);
+
+#if defined(RCC_D2CCIP2R_LPTIM1SEL)  // H7
+	RCC->APB1LENR |= RCC_APB1LENR_LPTIM1EN;
+	RCC->D2CCIP2R = (RCC->D2CCIP2R & ~RCC_D2CCIP2R_LPTIM1SEL)
+		| (lse ? (RCC_D2CCIP2R_LPTIM1SEL_0 | RCC_D2CCIP2R_LPTIM1SEL_1) : RCC_D2CCIP2R_LPTIM1SEL_2);
+	EXTI->IMR2 |= EXTI_IMR2_IM47;
+#elif defined(RCC_DCKCFGR2_LPTIM1SEL)  // F7
+	RCC->APB1ENR |= RCC_APB1ENR_LPTIM1EN;
+	RCC->DCKCFGR2 = (RCC->DCKCFGR2 & ~RCC_DCKCFGR2_LPTIM1SEL) | (lse ? RCC_DCKCFGR2_LPTIM1SEL : RCC_DCKCFGR2_LPTIM1SEL_0);
+	EXTI->IMR  |= EXTI_IMR_MR23;
+	EXTI->RTSR |= EXTI_RTSR_TR23;
+#elif defined(RCC_APB1ENR1_LPTIM1EN)  // G4
+	RCC->APB1ENR1 |= RCC_APB1ENR1_LPTIM1EN;
+	RCC->CCIPR = (RCC->CCIPR & ~RCC_CCIPR_LPTIM1SEL) | (lse ? RCC_CCIPR_LPTIM1SEL : RCC_CCIPR_LPTIM1SEL_0);
+	EXTI->IMR2 |= EXTI_IMR2_IM32;
+#else  // L0
+	RCC->APB1ENR |= RCC_APB1ENR_LPTIM1EN;
+	RCC->CCIPR = (RCC->CCIPR & ~RCC_CCIPR_LPTIM1SEL) | (lse ? RCC_CCIPR_LPTIM1SEL : RCC_CCIPR_LPTIM1SEL_0);
+	EXTI->IMR |= EXTI_IMR_IM29;
+#endif
+
+	// 16 bit counter with the smallest possible prescaler (1 .. 128)
+
+	uint64_t ticks = (uint64_t(aus) * lptim_hz) / 1000000;
+	unsigned prescshift = 0;
+	while ((ticks >> prescshift) > 0xFFFF)
+	{
+		if (prescshift >= 7)
+		{
+			ticks = (0xFFFFull << 7);  // limit to the maximal time
+			break;
+		}
+		++prescshift;
+	}
+
+	unsigned arr = unsigned(ticks >> prescshift);
+	if (arr < 2)
+	{
+		return false;  // too short
+	}
+
+	lptim_presc = (1 << prescshift);
+
+	LPTIM1->CR = 0;
+	LPTIM1->CFGR = (prescshift * LPTIM_CFGR_PRESC_0);  // internal clock, software trigger
+	LPTIM1->IER = LPTIM_IER_ARRMIE;  // IER and CFGR can be written only when disabled
+	LPTIM1->CR = LPTIM_CR_ENABLE;
+	LPTIM1->ICR = 0x7F;  // clear all flags
+	LPTIM1->ARR = arr;
+	while (0 == (LPTIM1->ISR & LPTIM_ISR_ARROK))
+	{
+		// wait for the synchronization to the LPTIM clock
+	}
+
+	NVIC_ClearPendingIRQ(LPTIM1_IRQn);
+	NVIC_EnableIRQ(LPTIM1_IRQn);  // the WFI wakes up only for an enabled IRQ
+
+	LPTIM1->CR = (LPTIM_CR_ENABLE | LPTIM_CR_SNGSTRT);
+
+	return true;
+}
+
+unsigned THwLowPower_stm32::StopWakeupTimer()
+{
+	unsigned ticks;
+	if (LPTIM1->ISR & LPTIM_ISR_ARRM)
+	{
+		ticks = LPTIM1->ARR;  // expired
+	}
+	else
+	{
+		// the counter runs asynchronously, two equal reads are required
+		unsigned cnt;
+		do
+		{
+			cnt = LPTIM1->CNT;
+		}
+		while (cnt != LPTIM1->CNT);
+		ticks = cnt;
+	}
+
+	LPTIM1->CR = 0;
+	LPTIM1->ICR = 0x7F;
+
+	NVIC_DisableIRQ(LPTIM1_IRQn);
+	NVIC_ClearPendingIRQ(LPTIM1_IRQn);
+
+	return unsigned((uint64_t(ticks) * lptim_presc * 1000000) / lptim_hz);
+}
+
+#endif
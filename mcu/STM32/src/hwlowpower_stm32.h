@@ -0,0 +1,69 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwlowpower_stm32.h
+ *  brief:    STM32 Low Power Modes
+ *  version:  1.00
+ *  date:     2021-08-14
+ *  authors:  nvitya
+*/
+
+#ifndef HWLOWPOWER_STM32_H_
+#define HWLOWPOWER_STM32_H_
+
+#define HWLOWPOWER_PRE_ONLY
+#include "hwlowpower.h"
+
+#if defined(LPTIM1) && (defined(RCC_DCKCFGR2_LPTIM1SEL) || defined(RCC_CCIPR_LPTIM1SEL) || defined(RCC_D2CCIP2R_LPTIM1SEL))
+  #define HWLOWPOWER_STM32_LPTIM
+#endif
+
+#ifndef HWLOWPOWER_LSI_HZ
+  #if defined(MCUSF_L0)
+    #define HWLOWPOWER_LSI_HZ  37000
+  #else
+    #define HWLOWPOWER_LSI_HZ  32000
+  #endif
+#endif
+
+class THwLowPower_stm32 : public THwLowPower_pre
+{
+public:
+	bool DeepSleepSupported()  { return true; }
+
+	void EnterDeepSleep();         // STOP mode
+	void RestoreAfterDeepSleep();
+
+#ifdef HWLOWPOWER_STM32_LPTIM
+public: // wake up timer with the LPTIM1, clocked from the LSE when it runs, otherwise from the LSI (not accurate!)
+	unsigned  lptim_hz = 0;        // the selected LPTIM clock
+
+	bool      StartWakeupTimer(unsigned aus);
+	unsigned  StopWakeupTimer();
+
+protected:
+	unsigned  lptim_presc = 0;     // power of 2
+#endif
+};
+
+#define HWLOWPOWER_IMPL   THwLowPower_stm32
+
+#endif // def HWLOWPOWER_STM32_H_
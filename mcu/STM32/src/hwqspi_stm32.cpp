@@ -66,6 +66,10 @@ bool THwQspi_stm32::InitInterface() // the pins must be configured before, becau
 	B11: NCS
 */
 
+	// the DLR is 32 bit and the clock is stopped when the FIFO is full,
+	// so a read command can stream over the DMA chunk boundaries
+	maxdatalen = 0x10000000;
+
 #if defined(MCUSF_G4)
 	txdma.Init(dmanum, dmach, 40);  // request 40 = QUADSPI
 	rxdma.Init(dmanum, dmach, 40);  // use the same channel for tx and rx
@@ -126,7 +130,7 @@ bool THwQspi_stm32::Init()
 	;
 
 	tmp = 0
-		| (23 << 16) // FSIZE(5): Flash memory size (in 2^(FSIZE+1) bytes)
+		| (FsizeCode() << 16) // FSIZE(5): Flash memory size (in 2^(FSIZE+1) bytes)
 		| (0  <<  8) // CSHT(3): chip select high time, 0 = 1 cycles, 1 = 2 cycles ...
 		| (0  <<  0) // CKMODE: 0 = idle clock low, 1 = idle clock high
 	;
@@ -155,45 +159,119 @@ bool THwQspi_stm32::Init()
 	return true;
 }
 
-void THwQspi_stm32::SetMemMappedMode()
+bool THwQspi_stm32::SetMemMappedMode(unsigned acmd, bool acontinuous)
 {
 	while (busy)
 	{
 		Run();
 	}
 
-	unsigned cmd = 0x0B; // fast read;
-	unsigned dummy = 8;
-	unsigned abmode = 0;
-
-	if (multi_line_count == 2)
-	{
-		cmd = 0x3B; // dual data
-	}
-	else if (multi_line_count == 4)
+	if (memmapped)
 	{
-		cmd = 0x6B; // quad data
+		SetIndirectMode();
 	}
 
+	unsigned fields = ((acmd >> 8) & 0xF);
+	unsigned lcode  = ((fields & 2) ? mlcode : 1);  // address, mode and dummy line count
+
 	unsigned ccr = 0
 		| (0 << 31) // DDRM: double data rate mode
 		| (0 << 30) // DHHC: DDR hold
 		| (0 << 28) // SIOO: send instruction only once, 0 = send inst. for every transaction
 		| (3 << 26) // FMODE(2): functional mode, 0 = write mode, 1 = read mode, 2 = polling, 3 = memory mapped
-		| (mlcode << 24) // DMODE(2): data mode, 0 = no data, 1 = single, 2 = dual, 4 = quad
-		| (dummy  << 18) // DCYC(5): number of dummy cycles
-		| (0 << 16) // ABSIZE(2): alternate byte size, 0 = 1 byte, 3 = 4 byte
-		| (0 << 14) // ABMODE(2): alternate byte mode, 0 = no bytes, 1 = single, 2 = dual, 3 = quad
-		| (2 << 12) // ADSIZE(2): address size, 0 = 1 byte, 3 = 4 byte
-		| (1 << 10) // ADMODE(2): address mode, 0 = do not send, 1 = single, 2 = dual, 3 = quad
-		| (1 <<  8) // IMODE(2): instruction mode, 0 = do not send, 1 = single, 2 = dual, 3 = quad
-		| ((cmd & 0xFF) <<  0) // INSTRUCTION(8): command / instruction byte
+		| (((fields & 8) ? mlcode : 1) << 24) // DMODE(2): data mode, 0 = no data, 1 = single, 2 = dual, 4 = quad
+		| (lcode << 10) // ADMODE(2): address mode, 0 = do not send, 1 = single, 2 = dual, 3 = quad
+		| (((fields & 1) ? mlcode : 1) <<  8) // IMODE(2): instruction mode, 0 = do not send, 1 = single, 2 = dual, 3 = quad
+		| ((acmd & 0xFF) <<  0) // INSTRUCTION(8): command / instruction byte
 	;
 
+	if (acontinuous)
+	{
+		// the flash stays in continuous read mode (set by the mode byte), no instruction is required
+		ccr |= (1 << 28);  // SIOO
+	}
+
+	// address
+	unsigned rqaddrlen = ((acmd >> 16) & 0xF);
+	if ((0 == rqaddrlen) || (8 == rqaddrlen))
+	{
+		rqaddrlen = addrlen;
+	}
+	ccr |= ((rqaddrlen-1) << 12); // ADSIZE(2)
+
+	// mode / alternate bytes
+	unsigned ablen = ((acmd >> 28) & 0xF);
+	if (ablen)
+	{
+		if (8 == ablen)  ablen = modelen;
+		ccr |= (lcode << 14) | ((ablen-1) << 16); // ABMODE(2), ABSIZE(2)
+	}
+
+	// dummy
+	unsigned dummybytes = ((acmd >> 20) & 0xF);
+	if (dummybytes)
+	{
+		if (8 == dummybytes)  dummybytes = dummysize;
+
+		unsigned dummybits = (dummybytes * 8);
+		if (fields & 2)
+		{
+			if (multi_line_count == 4)       dummybits = (dummybytes << 1);
+			else if (multi_line_count == 2)  dummybits = (dummybytes << 2);
+		}
+		ccr |= (dummybits << 18); // DCYC(5)
+	}
+
 	regs->FCR = 0x1F;
-	regs->ABR = 0;
-	//regs->AR = 0;
+	regs->ABR = modedata;
 	regs->CCR = ccr;
+
+	memmapped = true;
+	return true;
+}
+
+void THwQspi_stm32::SetIndirectMode()
+{
+	if (!memmapped)
+	{
+		return;
+	}
+
+	// stop the memory mapped mode, the CPU must not access the mapped area after this
+
+	regs->CR |= QUADSPI_CR_ABORT;
+	while (regs->CR & QUADSPI_CR_ABORT) { }
+	while (regs->SR & QUADSPI_SR_BUSY)  { }
+
+	regs->FCR = 0x1F;
+	regs->CCR = 0;  // FMODE = indirect write
+
+	memmapped = false;
+}
+
+uint32_t THwQspi_stm32::FsizeCode()
+{
+	// the accesses above 2^(FSIZE+1) bytes raise transfer error and the mapped window is cut there
+	uint32_t fsize = 0;
+	while ((fsize < 31) && ((2u << fsize) < memsize))
+	{
+		++fsize;
+	}
+	return fsize;
+}
+
+void THwQspi_stm32::SetMemorySize(unsigned abytesize)
+{
+	memsize = abytesize;
+
+	if (!regs)
+	{
+		return;  // applied at Init()
+	}
+
+	while (regs->SR & QUADSPI_SR_BUSY)  { }  // the DCR can be written only when not busy
+
+	regs->DCR = (regs->DCR & ~QUADSPI_DCR_FSIZE) | (FsizeCode() << 16);
 }
 
 int THwQspi_stm32::StartReadData(unsigned acmd, unsigned address, void * dstptr, unsigned len)
@@ -532,13 +610,12 @@ void THwQspi_stm32::Run()
 		}
 		else
 		{
-
-			if ((sr & QUADSPI_SR_TCF) == 0) // transfer complete ?
+			if (dmaused && rxdma.Active())  // polls the long (chained) DMA transfers too
 			{
 				return;
 			}
 
-			if (dmaused && rxdma.Active())
+			if ((sr & QUADSPI_SR_TCF) == 0) // transfer complete ?
 			{
 				return;
 			}
@@ -47,10 +47,13 @@ public:
 
 	int  StartReadData(unsigned acmd, unsigned address, void * dstptr, unsigned len);
 	int  StartWriteData(unsigned acmd, unsigned address, void * srcptr, unsigned len);
-	void SetMemMappedMode();
+	bool SetMemMappedMode(unsigned acmd, bool acontinuous);  // acontinuous: send the instruction only once
+	void SetMemorySize(unsigned abytesize);  // updates the DCR.FSIZE, call only in indirect mode
+	void SetIndirectMode();
 	void Run();
 
 	uint32_t   mlcode = 0;
+	uint32_t   FsizeCode();
 	int        runstate = 0;
 };
 
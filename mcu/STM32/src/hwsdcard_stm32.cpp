@@ -45,6 +45,7 @@
   #define SDMMC_STA_CMDREND       SDIO_STA_CMDREND
   #define SDMMC_STA_CTIMEOUT      SDIO_STA_CTIMEOUT
   #define SDMMC_STA_DTIMEOUT      SDIO_STA_DTIMEOUT
+  #define SDMMC_STA_TXUNDERR      SDIO_STA_TXUNDERR
   #define SDMMC_STA_DATAEND       SDIO_STA_DATAEND
   #define SDMMC_STA_RXDAVL        SDIO_STA_RXDAVL
 
@@ -417,6 +418,54 @@ void THwSdcard_stm32::StartDataReadCmd(uint8_t acmd, uint32_t cmdarg, uint32_t c
 
 void THwSdcard_stm32::StartDataWriteCmd(uint8_t acmd, uint32_t cmdarg, uint32_t cmdflags, void * dataptr, uint32_t datalen)
 {
+	StartDataWrite(dataptr, datalen, false);
+
+	// CMD
+
+	curcmd = acmd;
+	curcmdarg = cmdarg;
+	curcmdflags = cmdflags;
+
+	uint32_t waitresp = 0;
+	uint8_t restype = (cmdflags & SDCMD_RES_MASK);
+	if (restype)
+	{
+		// response present
+		if (restype == SDCMD_RES_48BIT)        waitresp = 1; // short response
+		else if (restype == SDCMD_RES_136BIT)  waitresp = 3; // long response
+		else if (restype == SDCMD_RES_R1B)     waitresp = 1; // short response
+	}
+
+	uint32_t cmdr = (0
+		|	SDMMC_CMD_CPSMEN
+		| (waitresp << SDMMC_CMD_WAITRESP_Pos)
+		| (acmd <<  SDMMC_CMD_CMDINDEX_Pos)
+	);
+
+#ifdef MCUSF_H7
+	cmdr |= SDMMC_CMD_CMDTRANS;
+#endif
+
+	regs->ICR = 0xFFFFFFFF; // clear all flags
+
+	regs->ARG = cmdarg;
+	regs->CMD = cmdr; // start the execution
+
+	cmderror = false;
+	cmdrunning = true;
+	lastcmdtime = CLOCKCNT;
+}
+
+void THwSdcard_stm32::StartDataWrite(void * dataptr, uint32_t datalen, bool astartnow)
+{
+	// astartnow: start the data path without command (continue an open CMD25 stream)
+
+	if (astartnow)
+	{
+		regs->ICR = 0xFFFFFFFF; // clear all flags
+		cmderror = false;
+	}
+
 	regs->DTIMER = 0xFFFFFF; // todo: adjust data timeout
 
 	uint32_t bsizecode = 9; // 512 byte
@@ -440,6 +489,11 @@ void THwSdcard_stm32::StartDataWriteCmd(uint8_t acmd, uint32_t cmdarg, uint32_t
 		| (0  <<  0)  // DTEN: 1 = start data without CPSM transfer command
 	);
 
+	if (astartnow)
+	{
+		dcr |= (1 << 0); // DTEN
+	}
+
 	// the DMA must be started before DCTRL (DTEN)
 
 	regs->IDMABASE0 = (uint32_t)dataptr;
@@ -479,41 +533,6 @@ void THwSdcard_stm32::StartDataWriteCmd(uint8_t acmd, uint32_t cmdarg, uint32_t
 
 	regs->DLEN = datalen;
 	regs->DCTRL = dcr;
-
-	// CMD
-
-	curcmd = acmd;
-	curcmdarg = cmdarg;
-	curcmdflags = cmdflags;
-
-	uint32_t waitresp = 0;
-	uint8_t restype = (cmdflags & SDCMD_RES_MASK);
-	if (restype)
-	{
-		// response present
-		if (restype == SDCMD_RES_48BIT)        waitresp = 1; // short response
-		else if (restype == SDCMD_RES_136BIT)  waitresp = 3; // long response
-		else if (restype == SDCMD_RES_R1B)     waitresp = 1; // short response
-	}
-
-	uint32_t cmdr = (0
-		|	SDMMC_CMD_CPSMEN
-		| (waitresp << SDMMC_CMD_WAITRESP_Pos)
-		| (acmd <<  SDMMC_CMD_CMDINDEX_Pos)
-	);
-
-#ifdef MCUSF_H7
-	cmdr |= SDMMC_CMD_CMDTRANS;
-#endif
-
-	regs->ICR = 0xFFFFFFFF; // clear all flags
-
-	regs->ARG = cmdarg;
-	regs->CMD = cmdr; // start the execution
-
-	cmderror = false;
-	cmdrunning = true;
-	lastcmdtime = CLOCKCNT;
 }
 
 void THwSdcard_stm32::RunTransfer()
@@ -528,6 +547,13 @@ void THwSdcard_stm32::RunTransfer()
 
 	cmdrunning = false;
 
+	if (card_busy && ((1 == trstate) || (11 == trstate) || (21 == trstate)))
+	{
+		// the card might still program the previous write, poll its status first
+		busy_trstate = trstate;
+		trstate = 120;
+	}
+
 	switch (trstate)
 	{
 	case 0: // idle
@@ -547,6 +573,24 @@ void THwSdcard_stm32::RunTransfer()
 		break;
 
 	case 11: // start write blocks
+		if ((blockcount > 1) && write_preerase)
+		{
+			SendCmd(55, rca, SDCMD_RES_48BIT);  // prepare application specific command
+			trstate = 12;
+			break;
+		}
+		trstate = 14; RunTransfer(); return;  // phase jump
+
+	case 12:
+		SendCmd(23, (blockcount & 0x7FFFFF), SDCMD_RES_48BIT);  // ACMD23: SET_WR_BLK_ERASE_COUNT
+		trstate = 13;
+		break;
+
+	case 13:
+		// the pre-erase is only a hint, its error is ignored
+		trstate = 14; RunTransfer(); return;  // phase jump
+
+	case 14:
 		//TRACE("s.w. STA=%08X\r\n", regs->STA);
 
 		cmdarg = startblock;
@@ -558,6 +602,47 @@ void THwSdcard_stm32::RunTransfer()
 		trstate = 101;
 		break;
 
+	// open-ended write stream (CMD25 kept open)
+
+	case 21: // open stream
+		if (stream_precount)
+		{
+			SendCmd(55, rca, SDCMD_RES_48BIT);  // prepare application specific command
+			trstate = 22;
+			break;
+		}
+		trstate = 24; RunTransfer(); return;  // phase jump
+
+	case 22:
+		SendCmd(23, (stream_precount & 0x7FFFFF), SDCMD_RES_48BIT);  // ACMD23: SET_WR_BLK_ERASE_COUNT
+		trstate = 23;
+		break;
+
+	case 23:
+		trstate = 24; RunTransfer(); return;  // phase jump
+
+	case 24:
+		cmdarg = startblock;
+		if (!high_capacity)  cmdarg <<= 9; // byte addressing for low capacity cards
+
+		StartDataWriteCmd(25, cmdarg, SDCMD_RES_48BIT, dataptr, blockcount * 512);
+		stream_open = true;
+
+		trstate = 111;
+		break;
+
+	case 31: // continue stream, only the data
+		StartDataWrite(dataptr, blockcount * 512, true);
+		trstate = 111;
+		break;
+
+	case 41: // close stream
+		SendCmd(12, 0, SDCMD_RES_R1B);
+		stream_open = false;
+		card_busy = true;  // the card programs the last blocks
+		trstate = 106;
+		break;
+
 	case 101: // wait until the block transfer finishes
 
 		if (cmderror)
@@ -583,10 +668,20 @@ void THwSdcard_stm32::RunTransfer()
 			{
 				// send the stop transmission command
 				SendCmd(12, 0, SDCMD_RES_R1B);
-				trstate = 105;  // wait until the stop command finishes
+				if (trwrite)
+				{
+					// do not wait for the card programming, the next transfer will check it
+					card_busy = true;
+					trstate = 106;
+				}
+				else
+				{
+					trstate = 105;  // wait until the stop command finishes
+				}
 			}
 			else
 			{
+				card_busy = trwrite;
 				completed = true;
 				trstate = 0; // finished
 			}
@@ -634,8 +729,67 @@ void THwSdcard_stm32::RunTransfer()
 		//TRACE("f. STA=%08X\r\n", regs->STA);
 
 		break;
-	}
 
+	case 111: // wait until the stream data block finishes
+		if (cmderror || (regs->STA & (SDMMC_STA_DCRCFAIL | SDMMC_STA_DTIMEOUT | SDMMC_STA_TXUNDERR)))
+		{
+			// these data errors never set the DATAEND
+			errorcode = 1;
+			if (dma.initialized)
+			{
+				dma.Disable();
+			}
+			SendCmd(12, 0, SDCMD_RES_R1B);  // close the stream
+			stream_open = false;
+			card_busy = true;
+			trstate = 106;
+		}
+		else
+		{
+			if (0 == (regs->STA & SDMMC_STA_DATAEND))
+			{
+				return;
+			}
+
+			if (dma.initialized && dma.Active())
+			{
+				return;
+			}
+
+			completed = true;
+			trstate = 0; // the stream stays open
+		}
+		break;
+
+	case 120: // card status polling after writes
+		SendCmd(13, rca, SDCMD_RES_48BIT);
+		trstate = 121;
+		break;
+
+	case 121:
+		if (cmderror)
+		{
+			card_busy = false;
+			errorcode = 3;
+			completed = true;
+			trstate = 0;
+		}
+		else
+		{
+			// READY_FOR_DATA alone is not enough, the card can be still in prg or rcv state
+			uint32_t cardstatus = GetCmdResult32();
+			if ((cardstatus & (1 << 8)) && (((cardstatus >> 9) & 0xF) == 4))  // READY_FOR_DATA, CURRENT_STATE = tran
+			{
+				card_busy = false;
+				trstate = busy_trstate;
+				RunTransfer();  // start the requested transfer
+				return;
+			}
+
+			trstate = 120; // repeat
+		}
+		break;
+	}
 }
 
 #endif
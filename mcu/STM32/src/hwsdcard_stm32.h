@@ -55,6 +55,7 @@ public:
 
 	void StartDataReadCmd(uint8_t acmd, uint32_t cmdarg, uint32_t cmdflags, void * dataptr, uint32_t datalen);
 	void StartDataWriteCmd(uint8_t acmd, uint32_t cmdarg, uint32_t cmdflags, void * dataptr, uint32_t datalen);
+	void StartDataWrite(void * dataptr, uint32_t datalen, bool astartnow);
 	void RunTransfer(); // the internal state machine for managing multi block reads
 
 	uint32_t GetCmdResult32();
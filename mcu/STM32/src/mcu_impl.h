@@ -55,6 +55,10 @@
   #include "hwdma_stm32_mxb.h"
 #endif
 
+#ifdef HWDMAMAN_H_
+  #include "hwdmaman_stm32.h"
+#endif
+
 #ifdef HWINTFLASH_H_
   #include "hwintflash_stm32.h"
 #endif
@@ -99,3 +103,7 @@
 #if defined(LTDC_SRCR_IMR) && defined(HWLCDCTRL_H_)
   #include "hwlcdctrl_stm32.h"
 #endif
+
+#ifdef HWLOWPOWER_H_
+  #include "hwlowpower_stm32.h"
+#endif
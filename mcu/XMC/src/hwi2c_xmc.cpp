@@ -468,8 +468,8 @@ void THwI2c_xmc::Run()
 
 		if (psr & (1 << 4)) // stop condition received ?
 		{
-			busy = false; // finished.
 			runstate = 50;
+			TransferFinished(); // busy = false, might start the next transfer
 		}
 
 	  break;
@@ -487,8 +487,8 @@ void THwI2c_xmc::Run()
 		break;
 
 	case 91:
-		busy = false; // finished.
 		runstate = 50;
+		TransferFinished(); // busy = false, might start the next transfer
 		break;
 
 	} // case
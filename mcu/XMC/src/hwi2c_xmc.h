@@ -62,6 +62,7 @@ public:
 	USIC_CH_TypeDef *   regs = nullptr;
 
 	bool Init(int ausicnum, int achnum, int ainputpin_scl, int ainputpin_sda);
+	void ClockChanged()  { if (initialized)  Init(usicnum, chnum, inputpin_scl, inputpin_sda); }
 
 	int  StartReadData(uint8_t  adaddr, unsigned aextra, void * dstptr, unsigned len);
 	int  StartWriteData(uint8_t adaddr, unsigned aextra, void * srcptr, unsigned len);
@@ -75,5 +76,6 @@ public:
 };
 
 #define HWI2C_IMPL THwI2c_xmc
+#define HWI2C_OWN_CLOCKCHANGED
 
 #endif // def HWI2C_XMC_H_
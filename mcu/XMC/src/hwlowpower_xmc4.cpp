@@ -0,0 +1,55 @@
+/* -----------------------------------------------------------------------------
+ * This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+ * Copyright (c) 2021 Viktor Nagy, nvitya
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from
+ * the use of this software. Permission is granted to anyone to use this
+ * software for any purpose, including commercial applications, and to alter
+ * it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software in
+ *    a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ *
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ *
+ * 3. This notice may not be removed or altered from any source distribution.
+ * --------------------------------------------------------------------------- */
+/*
+ *  file:     hwlowpower_xmc4.cpp
+ *  brief:    XMC4000 Low Power Modes
+ *  version:  1.00
+ *  date:     2021-08-14
+ *  authors:  nvitya
+ *
+ *  notes:
+ *    In the Deep Sleep mode the system clock is switched to the backup clock (fOFI) and the Flash
+ *    is powered down. The PLL is not powered down, so the hardware switches back to it at the wake up
+ *    without software intervention. The peripheral clocks are stopped (DSLEEPCR.xxxCR = 0).
+*/
+
+#include "platform.h"
+
+#ifdef MCUSF_4000
+
+#include "hwlowpower.h"
+
+void THwLowPower_xmc::EnterDeepSleep()
+{
+	SCU_CLK->DSLEEPCR = (0
+		| (0 << SCU_CLK_DSLEEPCR_SYSSEL_Pos)  // 0 = fOFI
+		| SCU_CLK_DSLEEPCR_FPDN_Msk            // Flash power down
+	);
+
+	SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+
+	__DSB();
+	__WFI();
+
+	SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+}
+
+#endif // def MCUSF_4000
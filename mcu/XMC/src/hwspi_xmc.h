@@ -42,6 +42,7 @@ public:
 	int                 inputpin = 0;
 
 	bool Init(int ausicnum, int achnum, int ainputpin);
+	void ClockChanged()  { if (initialized)  Init(usicnum, chnum, inputpin); }
 
 	inline bool TrySendData(uint16_t adata)
 	{
@@ -78,5 +79,6 @@ public:
 
 
 #define HWSPI_IMPL THwSpi_xmc
+#define HWSPI_OWN_CLOCKCHANGED
 
 #endif // def HWSPI_XMC_H_
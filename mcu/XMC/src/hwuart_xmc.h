@@ -36,6 +36,7 @@ class THwUart_xmc : public THwUart_pre
 {
 public:
 	bool Init(int ausicnum, int achnum, int ainputpin);
+	void ClockChanged()  { if (initialized)  Init(usicnum, chnum, inputpin); }
 
 	bool TrySendChar(char ach);
 	bool TryRecvChar(char * ach);
@@ -51,5 +52,6 @@ public:
 };
 
 #define HWUART_IMPL THwUart_xmc
+#define HWUART_OWN_CLOCKCHANGED
 
 #endif // def HWUART_XMC_H_
@@ -53,3 +53,7 @@
 #ifdef HWDMA_H_
   #define SKIP_UNIMPLEMENTED_WARNING
 #endif
+
+#if defined(HWLOWPOWER_H_) && defined(MCUSF_4000)
+  #include "hwlowpower_xmc.h"
+#endif
@@ -26,9 +26,10 @@
  *  authors:  nvitya
 */
 
+#include "string.h"
 #include "i2c_eeprom.h"
 
-bool TI2cEeprom::Init(THwI2c * ai2c, uint8_t aaddr, uint32_t abytesize)
+bool TI2cEeprom::Init(THwI2c * ai2c, uint8_t aaddr, uint32_t abytesize, unsigned apagesize, unsigned aaddrbytes)
 {
 	initialized = false;
 	pi2c = ai2c;
@@ -44,15 +45,23 @@ bool TI2cEeprom::Init(THwI2c * ai2c, uint8_t aaddr, uint32_t abytesize)
 		return false;
 	}
 
+	if ((apagesize == 0) || (apagesize > I2C_EEPROM_MAX_PAGESIZE) || (apagesize & (apagesize - 1)) || (aaddrbytes < 1) || (aaddrbytes > 2))
+	{
+		return false;
+	}
+
 	devaddr = aaddr;
 	bytesize = abytesize;
+	pagesize = apagesize;
+	addrbytes = aaddrbytes;
 
 	initialized = true;
 
 	// try to read the first 4 bytes
 
 	uint32_t data = 0;
-	errorcode = pi2c->StartReadData(devaddr + ((address >> 8) & 7), (address & 0xFF) | I2CEX_1, &data, 4);
+	CalcAddress(0);
+	errorcode = pi2c->StartReadData(chipaddr, extra, &data, 4);
 	if (errorcode != ERROR_OK)
 	{
 		initialized = false;
@@ -69,6 +78,21 @@ bool TI2cEeprom::Init(THwI2c * ai2c, uint8_t aaddr, uint32_t abytesize)
 	return true;
 }
 
+void TI2cEeprom::CalcAddress(unsigned aaddr)
+{
+	// the address bits above the word address go into the device address (block select bits)
+	if (addrbytes > 1)
+	{
+		chipaddr = devaddr + ((aaddr >> 16) & 7);
+		extra = (aaddr & 0xFFFF) | I2CEX_2;
+	}
+	else
+	{
+		chipaddr = devaddr + ((aaddr >> 8) & 7);
+		extra = (aaddr & 0xFF) | I2CEX_1;
+	}
+}
+
 bool TI2cEeprom::StartReadMem(unsigned aaddr, void * adstptr, unsigned alen)
 {
 	if (!initialized)
@@ -106,6 +130,16 @@ bool TI2cEeprom::StartReadMem(unsigned aaddr, void * adstptr, unsigned alen)
 }
 
 bool TI2cEeprom::StartWriteMem(unsigned aaddr, void * asrcptr, unsigned alen)
+{
+	return StartWrite(aaddr, asrcptr, alen, false);
+}
+
+bool TI2cEeprom::StartUpdateMem(unsigned aaddr, void * asrcptr, unsigned alen)
+{
+	return StartWrite(aaddr, asrcptr, alen, true);
+}
+
+bool TI2cEeprom::StartWrite(unsigned aaddr, void * asrcptr, unsigned alen, bool acompare)
 {
 	if (!initialized)
 	{
@@ -129,6 +163,7 @@ bool TI2cEeprom::StartWriteMem(unsigned aaddr, void * asrcptr, unsigned alen)
 	dataptr = (uint8_t *)asrcptr;
 	datalen = alen;
 	address = aaddr;
+	compare = acompare;
 
 	state = I2C_STATE_WRITEMEM; // write page
 	phase = 0;
@@ -156,7 +191,8 @@ void TI2cEeprom::Run()
 		switch (phase)
 		{
 			case 0: // start
-				pi2c->StartReadData(devaddr + ((address >> 8) & 7), (address & 0xFF) | I2CEX_1, dataptr, datalen);
+				CalcAddress(address);
+				pi2c->StartReadData(chipaddr, extra, dataptr, datalen);
 				phase = 1;
 				break;
 
@@ -172,12 +208,13 @@ void TI2cEeprom::Run()
 	}
 	else if (I2C_STATE_WRITEMEM == state)  // write memory
 	{
-		// by the writes the 16 byte internal page structure must be taken care of
+		// by the writes the internal page structure must be taken care of
 
 		switch (phase)
 		{
 			case 0: // initialization
 				remaining = datalen;
+				skippedpages = 0;
 				++phase;
 				break;
 
@@ -189,15 +226,27 @@ void TI2cEeprom::Run()
 					return;
 				}
 
-				chunksize = 16 - (address & 0xF);
+				chunksize = pagesize - (address & (pagesize - 1));
 				if (chunksize > remaining)  chunksize = remaining;
 
-				pi2c->StartWriteData(devaddr + ((address >> 8) & 7), (address & 0xFF) | I2CEX_1, dataptr, chunksize);
+				CalcAddress(address);
 
+				if (compare)
+				{
+					pi2c->StartReadData(chipaddr, extra, &rxbuf[0], chunksize);
+					phase = 10;
+					return;
+				}
+
+				++phase; Run();  // phase jump
+				return;
+
+			case 2: // start page write
+				pi2c->StartWriteData(chipaddr, extra, dataptr, chunksize);
 				++phase;
 				break;
 
-			case 2: // wait i2c send complete
+			case 3: // wait i2c send complete
 				if (pi2c->Finished())
 				{
 					errorcode = pi2c->error;
@@ -214,12 +263,12 @@ void TI2cEeprom::Run()
 				}
 				break;
 
-			case 3: // try reading until it answers ...
-				pi2c->StartReadData(devaddr, 0, &rxbuf[0], 1);
+			case 4: // try reading until it answers ...
+				pi2c->StartReadData(chipaddr, 0, &rxbuf[0], 1);
 				++phase;
 				break;
 
-			case 4: // wait completition
+			case 5: // wait completition
 				if (pi2c->Finished())
 				{
 					if (pi2c->error == 0) // read successful, that means that the write is completed
@@ -232,10 +281,36 @@ void TI2cEeprom::Run()
 					}
 					else
 					{
-						phase = 3; // continue polling
+						phase = 4; // continue polling
 					}
 				}
 				break;
+
+			case 10: // wait page read-back
+				if (pi2c->Finished())
+				{
+					errorcode = pi2c->error;
+					if (errorcode)
+					{
+						completed = true;
+						state = 0;
+						return;
+					}
+
+					if (memcmp(&rxbuf[0], dataptr, chunksize) != 0)
+					{
+						phase = 2;  Run();  return;  // write the page
+					}
+
+					// unchanged, skip it
+					++skippedpages;
+					dataptr += chunksize;
+					address += chunksize;
+					remaining -= chunksize;
+
+					phase = 1;  Run();  return;
+				}
+				break;
 		}
 	}
 }
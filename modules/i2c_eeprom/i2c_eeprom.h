@@ -24,6 +24,10 @@
  *  version:  1.00
  *  date:     2019-03-24
  *  authors:  nvitya
+ *
+ *  notes:
+ *    small devices (24C01..24C16): 16 byte pages, 1 address byte, block bits in the device address
+ *    large devices (24C32..24C512): 32..128 byte pages, 2 address bytes (I2CEX_2)
 */
 
 #ifndef I2C_EEPROM_H_
@@ -38,6 +42,10 @@
 #define I2C_STATE_READMEM   1
 #define I2C_STATE_WRITEMEM  2
 
+#ifndef I2C_EEPROM_MAX_PAGESIZE
+  #define I2C_EEPROM_MAX_PAGESIZE  256
+#endif
+
 class TI2cEeprom
 {
 public:
@@ -49,19 +57,23 @@ public:
 	THwI2c *       pi2c = nullptr;
 	uint8_t        devaddr = 0x50;
 	unsigned       bytesize = 0;
+	unsigned       pagesize = 16;    // must be power of 2
+	unsigned       addrbytes = 1;    // 1 or 2
 
-	bool           Init(THwI2c * ai2c, uint8_t aaddr, uint32_t abytesize);
+	bool           Init(THwI2c * ai2c, uint8_t aaddr, uint32_t abytesize, unsigned apagesize = 16, unsigned aaddrbytes = 1);
 
 	bool 					 StartReadMem(unsigned aaddr, void * adstptr, unsigned alen);
 	bool 					 StartWriteMem(unsigned aaddr, void * asrcptr, unsigned alen);
+	bool 					 StartUpdateMem(unsigned aaddr, void * asrcptr, unsigned alen); // writes only the changed pages
+
+	unsigned       skippedpages = 0;  // pages left unchanged by the last StartUpdateMem()
 
 	void           Run();
 	int            WaitComplete();
 
 protected:
 
-	unsigned char  txbuf[16];
-	unsigned char  rxbuf[16];
+	unsigned char  rxbuf[I2C_EEPROM_MAX_PAGESIZE];  // page compare buffer
 
 	// state machine
 	int            state = 0;
@@ -74,6 +86,13 @@ protected:
 	unsigned       datalen = 0;
 	unsigned       address = 0;
 	unsigned       remaining = 0;
+	bool           compare = false;
+
+	uint8_t        chipaddr = 0;
+	unsigned       extra = 0;
+
+	void           CalcAddress(unsigned aaddr);  // sets chipaddr and extra
+	bool           StartWrite(unsigned aaddr, void * asrcptr, unsigned alen, bool acompare);
 };
 
 #endif /* I2C_EEPROM_H_ */
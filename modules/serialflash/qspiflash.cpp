@@ -33,65 +33,197 @@ bool TQspiFlash::InitInherited()
 {
 	qspi.Init();
 
+	maxchunksize = qspi.maxdatalen;  // long reads with one command when the QSPI can do it
+
+	if (!ReadIdCode())
+	{
+		return false;
+	}
+
+	ReadSfdpParams();
+
 	if (qspi.multi_line_count == 4)
 	{
 		// The Quad mode must be enabled (switch HOLD and WP pins to IO2 and IO3)
-		// This is done usually with status register write but the bit number is manufacturer specific
-
-		if (!ReadIdCode())
+		if (!QuadEnable())
 		{
+			// unknown hardware
+			qspi.multi_line_count = 2; // falling back to dual mode
+			SelectReadCmd();
 			return false;
 		}
+	}
 
-		unsigned char mnfid = (idcode & 0xFF);
+	SelectReadCmd();
 
+	return true;
+}
+
+bool TQspiFlash::QuadEnable()
+{
+	// This is done usually with status register write but the bit number is manufacturer specific
+	// The SFDP QER field tells it, otherwise a manufacturer table is used
+
+	unsigned char mnfid = (idcode & 0xFF);
+	uint8_t  wrcmd;
+	unsigned data;
+	unsigned datalen;
+
+	unsigned qer = qe_method;
+	if (SERIALFLASH_QE_UNKNOWN == qer)
+	{
 		if ((0x9D == mnfid) || (0xC2 == mnfid))
 		{
 			// 0x9D = ISSI
 			// 0xC2 = MXIC / Macronix
-			// Quad enable is status bit 6
-
-			qspi.StartWriteData(0x06, 0, nullptr, 0);  // Enable write
-			qspi.WaitFinish();
-
-			unsigned data = 0x40;
-			qspi.StartWriteData(0x01, 0, &data, 1);  // Write status register bit 6
-			qspi.WaitFinish();
-
-			do
-			{
-				StartReadStatus();
-				qspi.WaitFinish();
-			}
-			while (statusreg & 1);
-
+			qer = 2; // Quad enable is status bit 6
 		}
 		else if (0xEF == mnfid)
 		{
 			// Winbond
-			// Quad enable is status register bit 9
-			qspi.StartWriteData(0x06, 0, nullptr, 0);  // Enable write
-			qspi.WaitFinish();
-
-			unsigned data = 0x200;
-			qspi.StartWriteData(0x01, 0, &data, 2);  // Write status register bit 9
-			qspi.WaitFinish();
-
-			do
-			{
-				StartReadStatus();
-				qspi.WaitFinish();
-			}
-			while (statusreg & 1);
+			qer = 1; // Quad enable is status register bit 9
 		}
 		else
 		{
-			// unknown hardware
-			qspi.multi_line_count = 2; // falling back to dual mode
 			return false;
 		}
 	}
 
+	if (0 == qer)
+	{
+		return true;  // no quad enable bit (or the IO2/IO3 is always enabled)
+	}
+	else if (2 == qer)
+	{
+		wrcmd = 0x01;  data = 0x40;  datalen = 1;  // status register 1 bit 6
+	}
+	else if (3 == qer)
+	{
+		wrcmd = 0x3E;  data = 0x80;  datalen = 1;  // status register 2 bit 7, written with 0x3E
+	}
+	else if (6 == qer)
+	{
+		wrcmd = 0x31;  data = 0x02;  datalen = 1;  // status register 2 bit 1, written with 0x31
+	}
+	else if ((1 == qer) || (4 == qer) || (5 == qer))
+	{
+		wrcmd = 0x01;  data = 0x200;  datalen = 2;  // status register 2 bit 1, written together with the SR1
+	}
+	else
+	{
+		return false;
+	}
+
+	qspi.StartWriteData(0x06, 0, nullptr, 0);  // Enable write
+	qspi.WaitFinish();
+
+	qspi.StartWriteData(wrcmd, 0, &data, datalen);
+	qspi.WaitFinish();
+
+	do
+	{
+		StartReadStatus();
+		qspi.WaitFinish();
+	}
+	while (statusreg & 1);
+
+	return true;
+}
+
+unsigned TQspiFlash::SfdpReadCmdCode(TSerialFlashReadCmd * ardcmd, unsigned alinemode, unsigned alines)
+{
+	// converts the SFDP clock counts to QSPICM_ byte counts, returns 0 when it is not possible
+
+	if (!ardcmd->opcode)
+	{
+		return 0;
+	}
+
+	unsigned modeclocks = ardcmd->modeclocks;
+	unsigned dummyclocks = ardcmd->dummyclocks;
+	unsigned clkperbyte = 8;  // the mode and dummy are sent on the address lines
+	if (QSPICM_SMM == alinemode)
+	{
+		clkperbyte = (8 / alines);
+	}
+	else
+	{
+		dummyclocks += modeclocks;  // mode bits on single line are not used
+		modeclocks = 0;
+	}
+
+	if ((modeclocks % clkperbyte) || (dummyclocks % clkperbyte))
+	{
+		return 0;
+	}
+
+	unsigned modebytes = modeclocks / clkperbyte;
+	unsigned dummybytes = dummyclocks / clkperbyte;
+	if ((modebytes > 4) || (dummybytes > 7))  // 8 would mean the default size
+	{
+		return 0;
+	}
+
+	return (ardcmd->opcode | alinemode | QSPICM_ADDR | (modebytes << 28) | (dummybytes << 20));
+}
+
+void TQspiFlash::SelectReadCmd()
+{
+	readcmd = 0;
+
+	if (sfdp_valid)
+	{
+		if (qspi.multi_line_count == 4)
+		{
+			readcmd = SfdpReadCmdCode(&read_144, QSPICM_SMM, 4);
+			if (!readcmd)  readcmd = SfdpReadCmdCode(&read_114, QSPICM_SSM, 4);
+		}
+		else if (qspi.multi_line_count == 2)
+		{
+			readcmd = SfdpReadCmdCode(&read_122, QSPICM_SMM, 2);
+			if (!readcmd)  readcmd = SfdpReadCmdCode(&read_112, QSPICM_SSM, 2);
+		}
+	}
+
+	if (readcmd)
+	{
+		qspi.modedata = 0;  // no continuous read mode for the indirect reads
+	}
+	else if (qspi.multi_line_count == 4)
+	{
+		// 0x6B is safer
+		readcmd = (0x6B | QSPICM_SSM | QSPICM_ADDR | QSPICM_DUMMY);
+	}
+	else if (qspi.multi_line_count == 2)
+	{
+		// 0x3B is safer
+		readcmd = (0x3B | QSPICM_SSM | QSPICM_ADDR | QSPICM_DUMMY);
+	}
+	else
+	{
+		readcmd = (0x0B | QSPICM_SSS | QSPICM_ADDR | QSPICM_DUMMY);
+	}
+}
+
+bool TQspiFlash::ReadSfdp(unsigned aaddr, void * adst, unsigned alen)
+{
+	qspi.StartReadData(0x5A | QSPICM_SSS | QSPICM_ADDR3 | QSPICM_DUMMY1, aaddr, adst, alen);
+	qspi.WaitFinish();
+	return true;
+}
+
+bool TQspiFlash::Enter4ByteMode()
+{
+	qspi.SetMemorySize(bytesize);  // extend the accessible range of the controller
+
+	qspi.StartWriteData(0x06, 0, nullptr, 0);  // some devices require write enable for the 4 byte mode
+	qspi.WaitFinish();
+
+	qspi.StartWriteData(0xB7, 0, nullptr, 0);  // enter 4 byte address mode
+	qspi.WaitFinish();
+
+	qspi.addrlen = 4;
+	addrbytes = 4;
 	return true;
 }
 
@@ -115,7 +247,78 @@ bool TQspiFlash::ReadIdCode()
 	return true;
 }
 
+bool TQspiFlash::EnterMemMappedMode()
+{
+	if (!initialized || !completed)
+	{
+		return false;
+	}
+
+	bool result;
+	if (sfdp_valid)
+	{
+		// the read command was selected from the SFDP, continuous mode is possible when it has mode bits
+		bool contmode = (xip_continuous && (readcmd & QSPICM_MODE_MASK));
+		qspi.modedata = (contmode ? xip_modebyte : 0);
+		result = qspi.SetMemMappedMode(readcmd, contmode);
+		xip_contmode = (result && contmode);
+	}
+	else if ((4 == qspi.multi_line_count) && xip_continuous)
+	{
+		qspi.modedata = xip_modebyte;
+		result = qspi.SetMemMappedMode(0xEB | QSPICM_SMM | QSPICM_ADDR | QSPICM_MODE1 | QSPICM_DUMMY2, true);
+		xip_contmode = result;
+	}
+	else
+	{
+		result = qspi.SetMemMappedMode(readcmd, false);
+	}
+
+	xip_requested = result;
+	return result;
+}
+
+void TQspiFlash::LeaveMemMappedMode()
+{
+	xip_requested = false;
+	SetIndirectMode();
+}
+
+void TQspiFlash::SetIndirectMode()
+{
+	if (!qspi.memmapped)
+	{
+		return;
+	}
+
+	qspi.SetIndirectMode();
+
+	if (xip_contmode)
+	{
+		// the flash is still in continuous read mode, a mode byte of 0xFF terminates it
+		// (the dummy 0xFF instruction and the 0xFFFFFFFF quad address contain it in both interpretations)
+		qspi.StartWriteData(0xFF | QSPICM_SMM | QSPICM_ADDR4, 0xFFFFFFFF, nullptr, 0);
+		qspi.WaitFinish();
+		xip_contmode = false;
+	}
+}
+
 void TQspiFlash::Run()
+{
+	if ((state || firstreq) && qspi.memmapped)
+	{
+		SetIndirectMode();  // xip_requested stays set
+	}
+
+	super::Run();  // runs the operation and the request queue
+
+	if (!state && xip_requested && !qspi.memmapped)
+	{
+		EnterMemMappedMode();
+	}
+}
+
+void TQspiFlash::RunOperation()
 {
 	if (0 == state)
 	{
@@ -129,6 +332,7 @@ void TQspiFlash::Run()
 		{
 			case 0: // start
 				remaining = datalen;
+				qspi.modedata = 0;  // do not enter the continuous read mode
 				phase = 2;
 				break;
 
@@ -145,26 +349,7 @@ void TQspiFlash::Run()
 				chunksize = maxchunksize;
 				if (chunksize > remaining)  chunksize = remaining;
 
-				if (qspi.multi_line_count == 4)
-				{
-					// 0x6B is safer
-					qspi.StartReadData(0x6B | QSPICM_SSM | QSPICM_ADDR | QSPICM_DUMMY, address, dataptr, chunksize);
-
-					// the 0xEB does not work sometime, requires mode implementation
-					//qspi.StartReadData(0xEB | QSPICM_SMM | QSPICM_ADDR3 | QSPICM_MODE1 | QSPICM_DUMMY2, address, dataptr, chunksize);
-				}
-				else if (qspi.multi_line_count == 2)
-				{
-					// 0x3B is safer
-					qspi.StartReadData(0x3B | QSPICM_SSM | QSPICM_ADDR | QSPICM_DUMMY, address, dataptr, chunksize);
-
-					// 0xBB does not work sometime, requires mode impementation and enable quad command (?)
-					//qspi.StartReadData(0xBB | QSPICM_SMM | QSPICM_ADDR | QSPICM_MODE1, address, dataptr, chunksize);
-				}
-				else
-				{
-					qspi.StartReadData(0x0B | QSPICM_SSS | QSPICM_ADDR | QSPICM_DUMMY, address, dataptr, chunksize);
-				}
+				qspi.StartReadData(readcmd, address, dataptr, chunksize);
 
 				phase = 3;
 				break;
@@ -322,23 +507,8 @@ void TQspiFlash::Run()
 
 			case 3: // erase sector / block
 
-				txbuf[0] = ((address >> 16) & 0xFF);
-				txbuf[1] = ((address >>  8) & 0xFF);
-				txbuf[2] = ((address >>  0) & 0xFF);
-				txbuf[3] = 0;
-
-				if (has4kerase && ((address & 0xFFFF) || (remaining < 0x10000)))
-				{
-					// 4k sector erase
-					chunksize = 0x01000;
-					qspi.StartWriteData(0x20, 0, &txbuf[0], 3);
-				}
-				else
-				{
-					// 64k block erase
-					chunksize = 0x10000;
-					qspi.StartWriteData(0xD8, 0, &txbuf[0], 3);
-				}
+				// the address is sent as data
+				qspi.StartWriteData(PrepareEraseCmd(), 0, &txbuf[0], AddrToBytes(&txbuf[0], address));
 
 				++phase;
 				break;
@@ -362,6 +532,11 @@ void TQspiFlash::Run()
 					// check the result
 					if (statusreg & 1) // busy
 					{
+						if (SuspendRequired())
+						{
+							phase = 30; Run();  // suspend for the waiting read
+							return;
+						}
 						// repeat status register read
 						phase = 7; Run();
 						return;
@@ -375,6 +550,50 @@ void TQspiFlash::Run()
 				// TODO: timeout
 				break;
 
+			case 30: // erase suspend
+				qspi.StartWriteData(suspend_cmd, 0, nullptr, 0);
+				++phase;
+				break;
+
+			case 31: // wait for command phase completition
+				if (qspi.Finished())
+				{
+					++phase; Run();  // phase jump
+					return;
+				}
+				break;
+
+			case 32: // read status register, the busy flag is cleared when the suspend is active
+				StartReadStatus();
+				++phase;
+				break;
+
+			case 33:
+				if (qspi.Finished())
+				{
+					if (statusreg & 1) // busy
+					{
+						phase = 32; Run();
+						return;
+					}
+					SuspendOperation();  // continues with phase 40 at resume
+				}
+				break;
+
+			case 40: // erase resume (ignored by the device when the erase finished before the suspend)
+				qspi.StartWriteData(resume_cmd, 0, nullptr, 0);
+				++phase;
+				break;
+
+			case 41: // wait for command phase completition
+				if (qspi.Finished())
+				{
+					erase_start_clock = CLOCKCNT;
+					phase = 7; Run();  // phase jump
+					return;
+				}
+				break;
+
 			case 20: // finished
 				completed = true;
 				state = 0; // go to idle
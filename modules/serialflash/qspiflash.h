@@ -24,6 +24,14 @@
  *  version:  1.00
  *  date:     2018-02-10
  *  authors:  nvitya
+ *
+ *  notes:
+ *    memory mapped (XIP) mode: EnterMemMappedMode() maps the flash into the CPU address space,
+ *    with quad lines the 0xEB continuous read mode is used (no instruction phase per access).
+ *    The operations started while memory mapped switch temporarily back to indirect mode,
+ *    so the CPU must not access the mapped area (nor execute from there) while they are running.
+ *
+ *    The read command, dummy cycles and the quad enable method are taken from the SFDP when the device has it.
 */
 
 
@@ -48,7 +56,17 @@ public:
 	// overrides
 	virtual bool   InitInherited();
 	virtual bool   ReadIdCode();
+	virtual bool   ReadSfdp(unsigned aaddr, void * adst, unsigned alen);
+	virtual bool   Enter4ByteMode();
 	virtual void   Run();
+	virtual void   RunOperation();
+
+public: // memory mapped mode
+	bool           xip_continuous = true;  // use the continuous read (performance enhance) mode with quad lines
+	uint8_t        xip_modebyte = 0xA5;    // enters / keeps the continuous read mode at most vendors
+
+	bool           EnterMemMappedMode();
+	void           LeaveMemMappedMode();
 
 protected:
 	// smaller buffers for simple things
@@ -59,6 +77,17 @@ protected:
 
 	unsigned       statusreg;
 
+	unsigned       readcmd = 0;  // fast read command (QSPICM_ code) selected by the SFDP and line count
+
+	bool           xip_requested = false;  // restore the memory mapped mode after the operations
+	bool           xip_contmode = false;
+
+	void SetIndirectMode();
+
+	bool QuadEnable();
+	void SelectReadCmd();
+	unsigned SfdpReadCmdCode(TSerialFlashReadCmd * ardcmd, unsigned alinemode, unsigned alines);
+
 	void StartReadStatus();
 	void StartWriteEnable();
 };
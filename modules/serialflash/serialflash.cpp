@@ -26,11 +26,21 @@
  *  authors:  nvitya
 */
 
+#include "string.h"
 #include <serialflash.h>
+#include "clockcnt.h"
 
 bool TSerialFlash::Init()
 {
 	initialized = false;
+	sfdp_valid = false;
+
+	firstreq = nullptr;
+	curreq = nullptr;
+	suspended = false;
+	suspend_supported = true;
+	suspend_cmd = 0x75;
+	resume_cmd  = 0x7A;
 
 	// call virtual functions
 	if (!InitInterface())
@@ -57,7 +67,31 @@ bool TSerialFlash::Init()
 		return false;
 	}
 
-	bytesize = (1 << (idcode >> 16));
+	if (!sfdp_valid)
+	{
+		ReadSfdpParams();  // might have been already done by the InitInherited()
+	}
+
+	if (!sfdp_valid)
+	{
+		bytesize = (1 << (idcode >> 16));
+
+		if (0xC2 == (idcode & 0xFF))
+		{
+			// Macronix uses the old suspend / resume opcodes
+			suspend_cmd = 0xB0;
+			resume_cmd  = 0x30;
+		}
+	}
+
+	if (bytesize > 0x1000000)
+	{
+		if (!Enter4ByteMode())
+		{
+			bytesize = 0x1000000;  // only the first 16 MByte is accessible with 3 address bytes
+		}
+	}
+
 	erasemask = (has4kerase ? 0x0FFF : 0xFFFF);
 
 	initialized = true;
@@ -76,79 +110,424 @@ bool TSerialFlash::InitInherited() // must be overridden
 }
 
 
-void TSerialFlash::Run()  // must be overridden
+void TSerialFlash::RunOperation()  // must be overridden
 {
 	errorcode = ERROR_NOTIMPL;
 	completed = true;
+	state = 0;
 }
 
-bool TSerialFlash::ReadIdCode()
+void TSerialFlash::Run()
 {
-	idcode = 0;
-	return false;
+	RunOperation();
+
+	if (state)
+	{
+		return;  // the operation is still running (or a nested Run() started a new one)
+	}
+
+	if (curreq)
+	{
+		FinishCurReq();
+		if (curreq || state)
+		{
+			return;  // the callback started a new one
+		}
+	}
+
+	if (suspended)
+	{
+		if (firstreq && (SERIALFLASH_STATE_READMEM == firstreq->cmd))
+		{
+			StartNextReq();  // serve all the reads before the resume
+		}
+		else
+		{
+			ResumeOperation();
+		}
+	}
+	else if (firstreq)
+	{
+		StartNextReq();
+	}
 }
 
-bool TSerialFlash::StartReadMem(unsigned aaddr, void * adstptr, unsigned alen)
+bool TSerialFlash::AddRead(TSerialFlashReq * areq, unsigned aaddr, void * adstptr, unsigned alen)
+{
+	areq->cmd = SERIALFLASH_STATE_READMEM;
+	areq->address = aaddr;
+	areq->dataptr = adstptr;
+	areq->datalen = alen;
+
+	return AddRequest(areq);
+}
+
+bool TSerialFlash::AddWrite(TSerialFlashReq * areq, unsigned aaddr, void * asrcptr, unsigned alen)
+{
+	areq->cmd = SERIALFLASH_STATE_WRITEMEM;
+	areq->address = aaddr;
+	areq->dataptr = asrcptr;
+	areq->datalen = alen;
+
+	return AddRequest(areq);
+}
+
+bool TSerialFlash::AddErase(TSerialFlashReq * areq, unsigned aaddr, unsigned alen)
+{
+	areq->cmd = SERIALFLASH_STATE_ERASE;
+	areq->address = aaddr;
+	areq->dataptr = nullptr;
+	areq->datalen = alen;
+
+	return AddRequest(areq);
+}
+
+bool TSerialFlash::AddRequest(TSerialFlashReq * areq)
 {
 	if (!initialized)
 	{
-		errorcode = ERROR_NOTINIT;
-		completed = true;
+		areq->errorcode = ERROR_NOTINIT;
+		areq->completed = true;
 		return false;
 	}
 
-	if (!completed)
+	areq->completed = false;
+	areq->errorcode = 0;
+	areq->next = nullptr;
+
+	if (SERIALFLASH_STATE_READMEM == areq->cmd)        areq->priority = 2;
+	else if (SERIALFLASH_STATE_WRITEMEM == areq->cmd)  areq->priority = 1;
+	else                                               areq->priority = 0;
+
+	// insert after the last request with the same or higher priority
+
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	TSerialFlashReq * prev = nullptr;
+	TSerialFlashReq * req = firstreq;
+	while (req && (req->priority >= areq->priority))
 	{
-		errorcode = ERROR_BUSY;  // this might be overwriten later
-		return false;
+		prev = req;
+		req = req->next;
 	}
 
-	dataptr = (uint8_t *)adstptr;
+	areq->next = req;
+	if (prev)  prev->next = areq;
+	else       firstreq = areq;
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+
+	if ((0 == state) && !curreq)
+	{
+		Run();  // starts it when idle, the running operation polls the queue otherwise
+	}
+
+	return true;
+}
+
+void TSerialFlash::WaitRequest(TSerialFlashReq * areq)
+{
+	while (!areq->completed)
+	{
+		Run();
+	}
+}
+
+void TSerialFlash::StartNextReq()
+{
+	unsigned pm = __get_PRIMASK();  // save interrupt disable status
+	__disable_irq();
+
+	curreq = firstreq;
+	firstreq = firstreq->next;
+
+ 	__set_PRIMASK(pm); // restore interrupt disable status
+
+	StartOperation(curreq->cmd, curreq->address, curreq->dataptr, curreq->datalen);
+}
+
+void TSerialFlash::FinishCurReq()
+{
+	TSerialFlashReq * req = curreq;
+	curreq = nullptr;
+
+	// the callback might add the same request object again
+	req->errorcode = errorcode;
+	req->completed = true;
+	if (req->callback)
+	{
+		(* (req->callback))(req->callbackarg);
+	}
+}
+
+void TSerialFlash::StartOperation(int astate, unsigned aaddr, void * adataptr, unsigned alen)
+{
+	dataptr = (uint8_t *)adataptr;
 	datalen = alen;
 	address = aaddr;
 
-	state = SERIALFLASH_STATE_READMEM; // read memory
+	state = astate;
 	phase = 0;
 
 	errorcode = 0;
 	completed = false;
 
-	Run();
+	if (SERIALFLASH_STATE_ERASE == astate)
+	{
+		erase_start_clock = CLOCKCNT;
+	}
 
-	return (errorcode == 0);
+	Run();
 }
 
-bool TSerialFlash::StartWriteMem(unsigned aaddr, void* asrcptr, unsigned alen)
+bool TSerialFlash::SuspendRequired()
 {
-	if (!initialized)
+	if (!erase_suspend || !suspend_supported || suspended || (SERIALFLASH_STATE_ERASE != state))
 	{
-		errorcode = ERROR_NOTINIT;
-		completed = true;
 		return false;
 	}
 
-	if (!completed)
+	// a direct StartEraseMem() caller waits for the completed flag, it must not be released by a suspend
+	if (!curreq)
 	{
-		errorcode = ERROR_BUSY;  // this might be overwriten later
 		return false;
 	}
 
-	dataptr = (uint8_t *)asrcptr;
-	datalen = alen;
-	address = aaddr;
+	TSerialFlashReq * req = firstreq;
+	if (!req || (SERIALFLASH_STATE_READMEM != req->cmd))
+	{
+		return false;
+	}
 
-	state = SERIALFLASH_STATE_WRITEMEM; // write page
-	phase = 0;
+	// the erase must progress between the suspends
+	if (CLOCKCNT - erase_start_clock < suspend_min_us * (SystemCoreClock / 1000000))
+	{
+		return false;
+	}
+
+	// reads from the block being erased would return invalid data
+	if ((req->address < address + chunksize) && (req->address + req->datalen > address))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+void TSerialFlash::SuspendOperation()
+{
+	susp_req = curreq;
+	curreq = nullptr;
+
+	susp_address = address;
+	susp_datalen = datalen;
+	susp_remaining = remaining;
+	susp_chunksize = chunksize;
+
+	suspended = true;
+	state = 0;
+	completed = true;
+}
+
+void TSerialFlash::ResumeOperation()
+{
+	suspended = false;
+
+	curreq = susp_req;
+	susp_req = nullptr;
+
+	dataptr = nullptr;
+	address = susp_address;
+	datalen = susp_datalen;
+	remaining = susp_remaining;
+	chunksize = susp_chunksize;
+
+	state = SERIALFLASH_STATE_ERASE;
+	phase = 40;  // send resume
 
 	errorcode = 0;
 	completed = false;
 
 	Run();
+}
 
-	return (errorcode == 0);
+bool TSerialFlash::ReadIdCode()
+{
+	idcode = 0;
+	return false;
 }
 
-bool TSerialFlash::StartEraseMem(unsigned aaddr, unsigned alen)
+bool TSerialFlash::ReadSfdp(unsigned aaddr, void * adst, unsigned alen)
+{
+	return false;
+}
+
+bool TSerialFlash::Enter4ByteMode()
+{
+	return false;
+}
+
+bool TSerialFlash::ReadSfdpParams()
+{
+	uint8_t   hdr[16];
+	uint32_t  bfpt[16];  // Basic Flash Parameter Table
+
+	sfdp_valid = false;
+
+	if (!ReadSfdp(0, &hdr[0], sizeof(hdr)))
+	{
+		return false;
+	}
+
+	if ((hdr[0] != 'S') || (hdr[1] != 'F') || (hdr[2] != 'D') || (hdr[3] != 'P'))
+	{
+		return false;
+	}
+
+	// the first parameter header must point to the BFPT (ID = 0x00)
+	unsigned dwcount = hdr[11];
+	unsigned tableaddr = (hdr[12] | (hdr[13] << 8) | (hdr[14] << 16));
+	if ((hdr[8] != 0x00) || (dwcount < 9))
+	{
+		return false;
+	}
+	if (dwcount > 16)  dwcount = 16;
+
+	memset(&bfpt[0], 0, sizeof(bfpt));
+	if (!ReadSfdp(tableaddr, &bfpt[0], dwcount * 4))
+	{
+		return false;
+	}
+
+	// DWORD 1: features
+	uint32_t dw = bfpt[0];
+	has4kerase = ((dw & 3) == 1);
+	erase_cmd_4k = (has4kerase ? ((dw >> 8) & 0xFF) : 0);
+	addrbytes = 3;  // the 4 byte only devices (address bytes = 2) are entered to 4 byte mode too
+
+	// DWORD 2: density
+	dw = bfpt[1];
+	if (dw & 0x80000000)
+	{
+		dw &= 0x7FFFFFFF;
+		bytesize = (dw > 34 ? 0x80000000 : (1u << (dw - 3)));
+	}
+	else
+	{
+		bytesize = ((dw + 1) >> 3);
+	}
+
+	// DWORD 3-4: fast read commands
+	read_144.opcode = 0;
+	read_114.opcode = 0;
+	read_112.opcode = 0;
+	read_122.opcode = 0;
+	if (bfpt[0] & (1 << 21))
+	{
+		read_144.opcode      = ((bfpt[2] >>  8) & 0xFF);
+		read_144.modeclocks  = ((bfpt[2] >>  5) & 0x07);
+		read_144.dummyclocks = ((bfpt[2] >>  0) & 0x1F);
+	}
+	if (bfpt[0] & (1 << 22))
+	{
+		read_114.opcode      = ((bfpt[2] >> 24) & 0xFF);
+		read_114.modeclocks  = ((bfpt[2] >> 21) & 0x07);
+		read_114.dummyclocks = ((bfpt[2] >> 16) & 0x1F);
+	}
+	if (bfpt[0] & (1 << 16))
+	{
+		read_112.opcode      = ((bfpt[3] >>  8) & 0xFF);
+		read_112.modeclocks  = ((bfpt[3] >>  5) & 0x07);
+		read_112.dummyclocks = ((bfpt[3] >>  0) & 0x1F);
+	}
+	if (bfpt[0] & (1 << 20))
+	{
+		read_122.opcode      = ((bfpt[3] >> 24) & 0xFF);
+		read_122.modeclocks  = ((bfpt[3] >> 21) & 0x07);
+		read_122.dummyclocks = ((bfpt[3] >> 16) & 0x1F);
+	}
+
+	// DWORD 8-9: erase types (size = 2^N, opcode)
+	erase_cmd_32k = 0;
+	erase_cmd_64k = 0;
+	for (unsigned n = 0; n < 4; ++n)
+	{
+		uint16_t et = (bfpt[7 + (n >> 1)] >> ((n & 1) << 4));
+		uint8_t  etsize = (et & 0xFF);
+		uint8_t  etcmd  = (et >> 8);
+		if      (12 == etsize)  { erase_cmd_4k  = etcmd;  has4kerase = true; }
+		else if (15 == etsize)  { erase_cmd_32k = etcmd; }
+		else if (16 == etsize)  { erase_cmd_64k = etcmd; }
+	}
+	if (!erase_cmd_64k)
+	{
+		erase_cmd_64k = 0xD8; // should not happen
+	}
+
+	// DWORD 15: quad enable requirements (JESD216A+)
+	if (dwcount >= 15)
+	{
+		qe_method = ((bfpt[14] >> 20) & 7);
+	}
+	else
+	{
+		qe_method = SERIALFLASH_QE_UNKNOWN;
+	}
+
+	// DWORD 12-13: suspend / resume (JESD216A+)
+	if (dwcount >= 13)
+	{
+		suspend_supported = !(bfpt[11] & 0x80000000);  // 0 = supported
+		if (suspend_supported)
+		{
+			suspend_cmd = ((bfpt[12] >> 24) & 0xFF);
+			resume_cmd  = ((bfpt[12] >> 16) & 0xFF);
+		}
+	}
+
+	sfdp_valid = true;
+	return true;
+}
+
+uint8_t TSerialFlash::PrepareEraseCmd()
+{
+	if (!(address & 0xFFFF) && (remaining >= 0x10000))
+	{
+		chunksize = 0x10000;
+		return erase_cmd_64k;
+	}
+
+	if (erase_cmd_32k && !(address & 0x7FFF) && (remaining >= 0x8000))
+	{
+		chunksize = 0x8000;
+		return erase_cmd_32k;
+	}
+
+	if (has4kerase && erase_cmd_4k)
+	{
+		chunksize = 0x1000;
+		return erase_cmd_4k;
+	}
+
+	chunksize = 0x10000;
+	return erase_cmd_64k;
+}
+
+unsigned TSerialFlash::AddrToBytes(uint8_t * adst, unsigned aaddr)
+{
+	if (addrbytes > 3)
+	{
+		*adst++ = ((aaddr >> 24) & 0xFF);
+	}
+	*adst++ = ((aaddr >> 16) & 0xFF);
+	*adst++ = ((aaddr >>  8) & 0xFF);
+	*adst++ = ((aaddr >>  0) & 0xFF);
+
+	return addrbytes;
+}
+
+bool TSerialFlash::StartReadMem(unsigned aaddr, void * adstptr, unsigned alen)
 {
 	if (!initialized)
 	{
@@ -163,22 +542,32 @@ bool TSerialFlash::StartEraseMem(unsigned aaddr, unsigned alen)
 		return false;
 	}
 
-	dataptr = nullptr;
-	datalen = alen;
-	address = aaddr;
+	StartOperation(SERIALFLASH_STATE_READMEM, aaddr, adstptr, alen);
 
-	state = SERIALFLASH_STATE_ERASE; // erase memory
-	phase = 0;
+	return (errorcode == 0);
+}
 
-	errorcode = 0;
-	completed = false;
+bool TSerialFlash::StartWriteMem(unsigned aaddr, void* asrcptr, unsigned alen)
+{
+	if (!initialized)
+	{
+		errorcode = ERROR_NOTINIT;
+		completed = true;
+		return false;
+	}
 
-	Run();
+	if (!completed || suspended || curreq || firstreq)
+	{
+		errorcode = ERROR_BUSY;  // this might be overwriten later
+		return false;
+	}
+
+	StartOperation(SERIALFLASH_STATE_WRITEMEM, aaddr, asrcptr, alen);
 
 	return (errorcode == 0);
 }
 
-bool TSerialFlash::StartEraseAll()
+bool TSerialFlash::StartEraseMem(unsigned aaddr, unsigned alen)
 {
 	if (!initialized)
 	{
@@ -187,19 +576,33 @@ bool TSerialFlash::StartEraseAll()
 		return false;
 	}
 
-	if (!completed)
+	if (!completed || suspended || curreq || firstreq)
 	{
 		errorcode = ERROR_BUSY;  // this might be overwriten later
 		return false;
 	}
 
-	state = SERIALFLASH_STATE_ERASEALL; // erase chip
-	phase = 0;
+	StartOperation(SERIALFLASH_STATE_ERASE, aaddr, nullptr, alen);
 
-	errorcode = 0;
-	completed = false;
+	return (errorcode == 0);
+}
 
-	Run();
+bool TSerialFlash::StartEraseAll()
+{
+	if (!initialized)
+	{
+		errorcode = ERROR_NOTINIT;
+		completed = true;
+		return false;
+	}
+
+	if (!completed || suspended || curreq || firstreq)
+	{
+		errorcode = ERROR_BUSY;  // this might be overwriten later
+		return false;
+	}
+
+	StartOperation(SERIALFLASH_STATE_ERASEALL, 0, nullptr, 0);
 
 	return (errorcode == 0);
 }
@@ -24,6 +24,14 @@
  *  version:  1.00
  *  date:     2018-02-10
  *  authors:  nvitya
+ *
+ *  notes:
+ *    Request queue: the AddRequest() queues the operations, the reads are served first.
+ *    A read request arriving during a sector / block erase suspends the erase (when the device supports it),
+ *    the erase is resumed when there are no more reads in the queue.
+ *    Reads overlapping with the block being erased wait for the erase.
+ *    The Start...() functions are direct, they return ERROR_BUSY while an operation is running.
+ *    The direct writes and erases return ERROR_BUSY also while an erase is suspended or requests are queued.
 */
 
 #ifndef SERIALFLASH_H_
@@ -40,16 +48,68 @@
 #define SERIALFLASH_STATE_ERASE     3
 #define SERIALFLASH_STATE_ERASEALL  4
 
+#define SERIALFLASH_QE_UNKNOWN    0xFF  // quad enable method is not known (no SFDP)
+
+class TSerialFlashReadCmd  // fast read command parameters from the SFDP
+{
+public:
+	uint8_t        opcode = 0;  // 0 = not supported
+	uint8_t        modeclocks = 0;
+	uint8_t        dummyclocks = 0;
+};
+
+typedef void (* PSerialFlashCbFunc)(void * arg);
+
+class TSerialFlashReq
+{
+public:
+	int                cmd = SERIALFLASH_STATE_READMEM;  // SERIALFLASH_STATE_READMEM, WRITEMEM, ERASE or ERASEALL
+	unsigned           address = 0;
+	void *             dataptr = nullptr;
+	unsigned           datalen = 0;
+
+	volatile bool      completed = true;
+	int                errorcode = 0;
+
+	PSerialFlashCbFunc callback = nullptr;
+	void *             callbackarg = nullptr;
+
+	uint8_t            priority = 0;  // set by the AddRequest(): reads first, then writes, then erases
+	TSerialFlashReq *  next = nullptr;
+};
+
 class TSerialFlash
 {
 public:
 
 public: // settings
-	unsigned       has4kerase = false;
+	unsigned       has4kerase = false;  // set automatically when the SFDP is present
+
+	bool           erase_suspend = true;     // suspend the erases for the queued reads
+	unsigned       suspend_min_us = 500;     // minimal erase progress time between resume and the next suspend
 
 public:
 	unsigned       idcode = 0;
-	unsigned       bytesize = 0; // auto-detected from JEDEC ID
+	unsigned       bytesize = 0; // auto-detected from SFDP or JEDEC ID
+
+public: // SFDP parameters
+	bool           sfdp_valid = false;
+	unsigned       addrbytes = 3;            // 4 for devices above 16 MByte
+
+	uint8_t        erase_cmd_4k  = 0x20;
+	uint8_t        erase_cmd_32k = 0;        // 0 = not supported / unknown
+	uint8_t        erase_cmd_64k = 0xD8;
+
+	uint8_t        qe_method = SERIALFLASH_QE_UNKNOWN;  // SFDP Quad Enable Requirements (QER) code
+
+	bool           suspend_supported = true;
+	uint8_t        suspend_cmd = 0x75;       // erase suspend
+	uint8_t        resume_cmd  = 0x7A;       // erase resume
+
+	TSerialFlashReadCmd  read_112;  // S cmd, S addr, 2 data lines
+	TSerialFlashReadCmd  read_122;
+	TSerialFlashReadCmd  read_114;
+	TSerialFlashReadCmd  read_144;
 
 	bool 					 initialized = false;
 	bool           completed = true;
@@ -66,9 +126,20 @@ public:
 	bool 					 StartEraseAll();
 	bool 					 StartWriteMem(unsigned aaddr, void * asrcptr, unsigned alen); // must be erased before
 
+	bool           AddRequest(TSerialFlashReq * areq);
+	bool           AddRead(TSerialFlashReq * areq, unsigned aaddr, void * adstptr, unsigned alen);
+	bool           AddWrite(TSerialFlashReq * areq, unsigned aaddr, void * asrcptr, unsigned alen);
+	bool           AddErase(TSerialFlashReq * areq, unsigned aaddr, unsigned alen);
+	void           WaitRequest(TSerialFlashReq * areq); // blocking
+
 	virtual bool   ReadIdCode();
+	virtual bool   ReadSfdp(unsigned aaddr, void * adst, unsigned alen);  // synchronous read with the 0x5A command
+	virtual bool   Enter4ByteMode();
 
-	virtual void   Run(); // must be overridden !
+	bool           ReadSfdpParams();
+
+	virtual void   Run();
+	virtual void   RunOperation(); // must be overridden !
 	void 					 WaitForComplete();
 
 protected:
@@ -85,6 +156,30 @@ protected:
 	unsigned       remaining = 0;
 	unsigned       erasemask = 0;
 
+	// request queue
+	TSerialFlashReq *  firstreq = nullptr;
+	TSerialFlashReq *  curreq = nullptr;
+
+	void           StartOperation(int astate, unsigned aaddr, void * adataptr, unsigned alen);
+	void           StartNextReq();
+	void           FinishCurReq();
+
+	// erase suspend
+	bool           suspended = false;
+	TSerialFlashReq *  susp_req = nullptr;
+	unsigned       susp_address = 0;
+	unsigned       susp_datalen = 0;
+	unsigned       susp_remaining = 0;
+	unsigned       susp_chunksize = 0;
+	unsigned       erase_start_clock = 0;  // CLOCKCNT at the erase start or at the last resume
+
+	bool           SuspendRequired();  // the erase state machines check it while polling the busy flag
+	void           SuspendOperation(); // called when the device confirmed the suspend
+	void           ResumeOperation();  // continues the erase state machine at phase 40 (send resume)
+
+	uint8_t        PrepareEraseCmd();  // selects the largest erase for the address and remaining, sets the chunksize
+	unsigned       AddrToBytes(uint8_t * adst, unsigned aaddr);  // returns the address length
+
 };
 
 
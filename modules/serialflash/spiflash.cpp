@@ -26,7 +26,9 @@
  *  authors:  nvitya
 */
 
+#include "string.h"
 #include "spiflash.h"
+#include "clockcnt.h"
 
 bool TSpiFlash::InitInherited()
 {
@@ -70,6 +72,43 @@ bool TSpiFlash::ReadIdCode()
 	return true;
 }
 
+bool TSpiFlash::ReadSfdp(unsigned aaddr, void * adst, unsigned alen)
+{
+	uint8_t * dp = (uint8_t *)adst;
+	while (alen > 0)
+	{
+		unsigned chunk = (alen > 8 ? 8 : alen);  // the txbuf and rxbuf are small
+
+		memset(&txbuf[0], 0, sizeof(txbuf));
+		txbuf[0] = 0x5A; // read SFDP
+		txbuf[1] = ((aaddr >> 16) & 0xFF);
+		txbuf[2] = ((aaddr >>  8) & 0xFF);
+		txbuf[3] = ((aaddr >>  0) & 0xFF);
+		// txbuf[4]: 8 dummy clocks
+
+		ExecCmd(5 + chunk);
+
+		memcpy(dp, &rxbuf[5], chunk);
+		dp    += chunk;
+		aaddr += chunk;
+		alen  -= chunk;
+	}
+
+	return true;
+}
+
+bool TSpiFlash::Enter4ByteMode()
+{
+	txbuf[0] = 0x06; // some devices require write enable for the 4 byte mode
+	ExecCmd(1);
+
+	txbuf[0] = 0xB7; // enter 4 byte address mode
+	ExecCmd(1);
+
+	addrbytes = 4;
+	return true;
+}
+
 void TSpiFlash::StartCmd(unsigned acmdlen)
 {
 	pin_cs.Set1();
@@ -104,7 +143,7 @@ void TSpiFlash::ExecCmd(unsigned acmdlen)
 	pin_cs.Set1();
 }
 
-void TSpiFlash::Run()
+void TSpiFlash::RunOperation()
 {
 	if (0 == state)
 	{
@@ -119,10 +158,7 @@ void TSpiFlash::Run()
 			case 0: // start
 				remaining = datalen;
 				txbuf[0] = 0x03; // read command
-				txbuf[1] = ((address >> 16) & 0xFF);
-				txbuf[2] = ((address >>  8) & 0xFF);
-				txbuf[3] = ((address >>  0) & 0xFF);
-				StartCmd(4);  // activates the CS too
+				StartCmd(1 + AddrToBytes(&txbuf[1], address));  // activates the CS too
 				phase = 1;
 				break;
 			case 1: // wait for address phase completition
@@ -218,10 +254,7 @@ void TSpiFlash::Run()
 
 			case 3: // write data
 				txbuf[0] = 0x02; // page program command
-				txbuf[1] = ((address >> 16) & 0xFF);
-				txbuf[2] = ((address >>  8) & 0xFF);
-				txbuf[3] = ((address >>  0) & 0xFF);
-				StartCmd(4);  // activates the CS too
+				StartCmd(1 + AddrToBytes(&txbuf[1], address));  // activates the CS too
 				++phase;
 				break;
 
@@ -343,22 +376,8 @@ void TSpiFlash::Run()
 
 			case 3: // erase sector / block
 
-				if (has4kerase && ((address & 0xFFFF) || (datalen < 0x10000)))
-				{
-					// 4k sector erase
-					chunksize = 0x01000;
-					txbuf[0] = 0x20;
-				}
-				else
-				{
-					// 64k block erase
-					chunksize = 0x10000;
-					txbuf[0] = 0xD8;
-				}
-				txbuf[1] = ((address >> 16) & 0xFF);
-				txbuf[2] = ((address >>  8) & 0xFF);
-				txbuf[3] = ((address >>  0) & 0xFF);
-				StartCmd(4);  // activates the CS too
+				txbuf[0] = PrepareEraseCmd();  // sets the chunksize too
+				StartCmd(1 + AddrToBytes(&txbuf[1], address));  // activates the CS too
 				++phase;
 				break;
 
@@ -382,6 +401,11 @@ void TSpiFlash::Run()
 					// check the result
 					if (rxbuf[1] & 1) // busy
 					{
+						if (SuspendRequired())
+						{
+							phase = 30; Run();  // suspend for the waiting read
+							return;
+						}
 						// repeat status register read
 						phase = 7; Run();
 						return;
@@ -395,6 +419,55 @@ void TSpiFlash::Run()
 				// TODO: timeout
 				break;
 
+			case 30: // erase suspend
+				txbuf[0] = suspend_cmd;
+				StartCmd(1);  // activates the CS too
+				++phase;
+				break;
+
+			case 31: // wait for command phase completition
+				if (spi.DmaRecvCompleted())
+				{
+					pin_cs.Set1(); // pull back the CS
+					++phase; Run();  // phase jump
+					return;
+				}
+				break;
+
+			case 32: // read status register, the busy flag is cleared when the suspend is active
+				StartReadStatus();
+				++phase;
+				break;
+
+			case 33:
+				if (spi.DmaRecvCompleted())
+				{
+					pin_cs.Set1(); // pull back the CS
+					if (rxbuf[1] & 1) // busy
+					{
+						phase = 32; Run();
+						return;
+					}
+					SuspendOperation();  // continues with phase 40 at resume
+				}
+				break;
+
+			case 40: // erase resume (ignored by the device when the erase finished before the suspend)
+				txbuf[0] = resume_cmd;
+				StartCmd(1);  // activates the CS too
+				++phase;
+				break;
+
+			case 41: // wait for command phase completition
+				if (spi.DmaRecvCompleted())
+				{
+					pin_cs.Set1(); // pull back the CS
+					erase_start_clock = CLOCKCNT;
+					phase = 7; Run();  // phase jump
+					return;
+				}
+				break;
+
 			case 20: // finished
 				completed = true;
 				state = 0; // go to idle
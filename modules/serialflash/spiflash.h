@@ -50,7 +50,9 @@ public:
 	// overrides
 	virtual bool   InitInherited();
 	virtual bool   ReadIdCode();
-	virtual void   Run();
+	virtual bool   ReadSfdp(unsigned aaddr, void * adst, unsigned alen);
+	virtual bool   Enter4ByteMode();
+	virtual void   RunOperation();
 
 public:
 	THwDmaTransfer txfer;
@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+# -----------------------------------------------------------------------------
+# This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+# Copyright (c) 2021 Viktor Nagy, nvitya
+#
+# This software is provided 'as-is', without any express or implied warranty.
+# In no event will the authors be held liable for any damages arising from
+# the use of this software. Permission is granted to anyone to use this
+# software for any purpose, including commercial applications, and to alter
+# it and redistribute it freely, subject to the following restrictions:
+#
+# 1. The origin of this software must not be misrepresented; you must not
+#    claim that you wrote the original software. If you use this software in
+#    a product, an acknowledgment in the product documentation would be
+#    appreciated but is not required.
+#
+# 2. Altered source versions must be plainly marked as such, and must not be
+#    misrepresented as being the original software.
+#
+# 3. This notice may not be removed or altered from any source distribution.
+# -----------------------------------------------------------------------------
+#  file:     hotplace.py
+#  brief:    Generates the hot code / data placement linker script includes
+#  version:  1.00
+#  date:     2021-08-12
+#  authors:  nvitya
+#
+#  usage:
+#    hotplace.py app.elf --profile prof.txt --list hot.txt --code-size 16384 --data-size 4096 --outdir ld
+#
+#    --profile: the output of the pcprof.py, the functions are selected by samples / byte
+#    --list:    function or object names (one per line, C++ names like in the pcprof.py output),
+#               lines starting with "data:" select read-only tables, these are always taken first
+#
+#  Generates the nvcm_hotcode.ld (ITCRAM) and nvcm_hotdata.ld (DTCRAM) into the outdir, these override
+#  the empty defaults in core/ld when the outdir is earlier in the linker search path.
+#  The application must be compiled with -ffunction-sections -fdata-sections.
+#  The size report shows the selected and the rejected items and the remaining space.
+# -----------------------------------------------------------------------------
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+def load_symbols(elffile, nm, cppfilt):
+	# returns dict demangled name -> list of (mangled name, size, type)
+	out = subprocess.check_output([nm, '-S', '--defined-only', elffile], universal_newlines=True)
+	entries = []
+	for line in out.splitlines():
+		parts = line.split()
+		if len(parts) != 4:
+			continue
+		entries.append((parts[3], int(parts[1], 16), parts[2]))
+
+	mangled = [e[0] for e in entries]
+	demangled = subprocess.check_output([cppfilt], input = '\n'.join(mangled), universal_newlines=True).splitlines()
+
+	result = {}
+	for e, dname in zip(entries, demangled):
+		result.setdefault(dname, []).append(e)
+		result.setdefault(e[0], []).append(e)  # the mangled / C name works too
+	return result
+
+def read_profile(fname):
+	# pcprof.py output lines: "   count        %   function"
+	result = []
+	pattern = re.compile(r'^\s*(\d+)\s+[\d.]+%\s+(.+)$')
+	with open(fname) as f:
+		for line in f:
+			m = pattern.match(line)
+			if m:
+				result.append((m.group(2).strip(), int(m.group(1))))
+	return result
+
+def read_list(fname):
+	codes = []
+	datas = []
+	with open(fname) as f:
+		for line in f:
+			line = line.strip()
+			if not line or line.startswith('#'):
+				continue
+			if line.startswith('data:'):
+				datas.append(line[5:].strip())
+			else:
+				codes.append(line)
+	return codes, datas
+
+def select(candidates, syms, types, budget, report, title):
+	# candidates: list of (name, weight), taken in the given order while they fit
+	selected = []
+	used = 0
+	report.append(title)
+	for name, weight in candidates:
+		found = [e for e in syms.get(name, []) if e[2] in types]
+		if not found:
+			report.append('    not found: %s' % name)
+			continue
+		mname, size, t = found[0]
+		if any(s[0] == mname for s in selected):
+			continue
+		if used + size > budget:
+			report.append('    no space:  %6d  %s' % (size, name))
+			continue
+		selected.append((mname, size, name))
+		used += size
+		report.append('    %6d  %s' % (size, name))
+
+	report.append('  used: %d / %d bytes, free: %d bytes' % (used, budget, budget - used))
+	report.append('')
+	return selected
+
+def write_ld(fname, secprefix, items, comment):
+	with open(fname, 'w') as f:
+		f.write('/* must be included into a section (%s) */\n' % comment)
+		f.write('/* generated by the hotplace.py, do not edit */\n\n')
+		for mname, size, name in items:
+			f.write('*(%s%s)  /* %d: %s */\n' % (secprefix, mname, size, name.replace('*/', '* /')))
+
+def main():
+	ap = argparse.ArgumentParser(description='NVCM hot code / data placement generator')
+	ap.add_argument('elf', help='the ELF file (linked with the current placement)')
+	ap.add_argument('--profile', help='pcprof.py output')
+	ap.add_argument('--list', help='explicit list of the hot functions and tables')
+	ap.add_argument('--code-size', type=int, default=16384, help='ITCRAM budget in bytes, default = 16384')
+	ap.add_argument('--data-size', type=int, default=0, help='DTCRAM budget for the tables in bytes, default = 0')
+	ap.add_argument('--min-samples', type=int, default=1, help='ignore the less sampled functions, default = 1')
+	ap.add_argument('--outdir', default='.', help='output directory for the nvcm_hotcode.ld and nvcm_hotdata.ld')
+	ap.add_argument('--nm', default='arm-none-eabi-nm', help='nm tool, default = arm-none-eabi-nm')
+	ap.add_argument('--cppfilt', default='arm-none-eabi-c++filt', help='c++filt tool, default = arm-none-eabi-c++filt')
+	args = ap.parse_args()
+
+	if not args.profile and not args.list:
+		ap.error('at least one of --profile or --list is required')
+
+	syms = load_symbols(args.elf, args.nm, args.cppfilt)
+
+	codes = []
+	datas = []
+	if args.list:
+		lcodes, datas = read_list(args.list)
+		codes += [(n, 0) for n in lcodes]  # the explicit ones first
+
+	if args.profile:
+		prof = []
+		for name, cnt in read_profile(args.profile):
+			if cnt < args.min_samples:
+				continue
+			found = [e for e in syms.get(name, []) if e[2] in 'tTwW']
+			if found and found[0][1] > 0:
+				prof.append((name, cnt / found[0][1]))  # samples per byte
+		prof.sort(key = lambda x: -x[1])
+		codes += prof
+
+	report = []
+	hotcode = select(codes, syms, 'tTwW', args.code_size, report, 'ITCRAM code (.text_ITCRAM):')
+	hotdata = select([(n, 0) for n in datas], syms, 'rR', args.data_size, report, 'DTCRAM tables (.text_DTCRAM):')
+
+	write_ld(os.path.join(args.outdir, 'nvcm_hotcode.ld'), '.text.', hotcode, '.text_ITCRAM')
+	write_ld(os.path.join(args.outdir, 'nvcm_hotdata.ld'), '.rodata.', hotdata, '.text_DTCRAM')
+
+	print('\n'.join(report))
+	return 0
+
+if __name__ == '__main__':
+	sys.exit(main())
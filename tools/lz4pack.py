@@ -0,0 +1,217 @@
+#!/usr/bin/env python3
+# -----------------------------------------------------------------------------
+# This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+# Copyright (c) 2021 Viktor Nagy, nvitya
+#
+# This software is provided 'as-is', without any express or implied warranty.
+# In no event will the authors be held liable for any damages arising from
+# the use of this software. Permission is granted to anyone to use this
+# software for any purpose, including commercial applications, and to alter
+# it and redistribute it freely, subject to the following restrictions:
+#
+# 1. The origin of this software must not be misrepresented; you must not
+#    claim that you wrote the original software. If you use this software in
+#    a product, an acknowledgment in the product documentation would be
+#    appreciated but is not required.
+#
+# 2. Altered source versions must be plainly marked as such, and must not be
+#    misrepresented as being the original software.
+#
+# 3. This notice may not be removed or altered from any source distribution.
+# -----------------------------------------------------------------------------
+#  file:     lz4pack.py
+#  brief:    Creates LZ4 compressed flash image for the nvcm_default_coderam_lz4.ld linked applications
+#  version:  1.00
+#  date:     2021-08-12
+#  authors:  nvitya
+#
+#  usage:
+#    lz4pack.py app.elf app_lz4.bin
+#
+#  The load images listed in the __ramcode_regions_array are compressed (LZ4 block format) and
+#  packed after each other, then the load addresses in the array are replaced with the
+#  compressed image addresses marked with bit 0. The bootcode.cpp decompresses these.
+#  Regions which do not get smaller are stored uncompressed.
+# -----------------------------------------------------------------------------
+
+import argparse
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+LZ4_MIN_MATCH = 4
+LZ4_MAX_OFFSET = 65535
+LZ4_LAST_LITERALS = 5   # the last 5 bytes are always literals
+LZ4_MFLIMIT = 12        # the last match must start at least 12 bytes before the end
+
+def lz4_write_len(out, alen):
+	while alen >= 255:
+		out.append(255)
+		alen -= 255
+	out.append(alen)
+
+def lz4_compress(data):
+	# greedy LZ4 block compressor with a 4 byte hash table
+	out = bytearray()
+	n = len(data)
+	table = {}
+	anchor = 0
+	i = 0
+	matchlimit = n - LZ4_LAST_LITERALS
+
+	while i < n - LZ4_MFLIMIT:
+		key = data[i : i + 4]
+		ref = table.get(key, -1)
+		table[key] = i
+		if (ref < 0) or (i - ref > LZ4_MAX_OFFSET):
+			i += 1
+			continue
+
+		# extend the match
+		mlen = 4
+		while (i + mlen < matchlimit) and (data[ref + mlen] == data[i + mlen]):
+			mlen += 1
+
+		litlen = i - anchor
+		mcode = mlen - LZ4_MIN_MATCH
+		out.append((min(litlen, 15) << 4) | min(mcode, 15))
+		if litlen >= 15:
+			lz4_write_len(out, litlen - 15)
+		out += data[anchor : i]
+		out += struct.pack('<H', i - ref)
+		if mcode >= 15:
+			lz4_write_len(out, mcode - 15)
+
+		# register some positions inside the match too
+		end = i + mlen
+		j = i + 1
+		while j < min(end, n - 4):
+			table[data[j : j + 4]] = j
+			j += 2
+
+		i = end
+		anchor = i
+
+	# last literals
+	litlen = n - anchor
+	out.append(min(litlen, 15) << 4)
+	if litlen >= 15:
+		lz4_write_len(out, litlen - 15)
+	out += data[anchor:]
+
+	return bytes(out)
+
+def lz4_decompress(src, dstlen):
+	# reference implementation for the verification, same as in the bootcode.cpp
+	dst = bytearray()
+	s = 0
+	while len(dst) < dstlen:
+		token = src[s]; s += 1
+		l = token >> 4
+		if l == 15:
+			while True:
+				b = src[s]; s += 1
+				l += b
+				if b != 255: break
+		dst += src[s : s + l]; s += l
+		if len(dst) >= dstlen:
+			break
+		offs = src[s] | (src[s + 1] << 8); s += 2
+		l = token & 15
+		if l == 15:
+			while True:
+				b = src[s]; s += 1
+				l += b
+				if b != 255: break
+		l += 4
+		for k in range(l):
+			dst.append(dst[-offs])
+	return bytes(dst)
+
+def load_symbols(elffile, nm, names):
+	out = subprocess.check_output([nm, '--defined-only', elffile], universal_newlines=True)
+	result = {}
+	for line in out.splitlines():
+		parts = line.split()
+		if (len(parts) == 3) and (parts[2] in names):
+			result[parts[2]] = int(parts[0], 16)
+	for name in names:
+		if name not in result:
+			sys.exit('Symbol "%s" not found, the application must be linked with nvcm_default_coderam_lz4.ld' % name)
+	return result
+
+def main():
+	parser = argparse.ArgumentParser(description='NVCM LZ4 compressed coderam image creator')
+	parser.add_argument('elffile')
+	parser.add_argument('binfile')
+	parser.add_argument('--objcopy', default='arm-none-eabi-objcopy')
+	parser.add_argument('--nm', default='arm-none-eabi-nm')
+	args = parser.parse_args()
+
+	syms = load_symbols(args.elffile, args.nm,
+	                    ['__bootcode_image_start', '__ramcode_regions_array_start', '__ramcode_regions_array_end'])
+
+	with tempfile.TemporaryDirectory() as tmpdir:
+		rawfile = os.path.join(tmpdir, 'raw.bin')
+		subprocess.check_call([args.objcopy, '-O', 'binary', args.elffile, rawfile])
+		with open(rawfile, 'rb') as f:
+			img = bytearray(f.read())
+
+	base = syms['__bootcode_image_start']
+	tabaddr = syms['__ramcode_regions_array_start']
+	tabend = syms['__ramcode_regions_array_end']
+
+	regions = []
+	for addr in range(tabaddr, tabend, 12):
+		loadaddr, dstaddr, dstend = struct.unpack_from('<III', img, addr - base)
+		regions.append([addr, loadaddr, dstaddr, dstend])
+
+	used = [r for r in regions if r[3] > r[2]]
+	if not used:
+		sys.exit('No regions to pack')
+
+	packaddr = min(r[1] for r in used)  # the first load image
+	if packaddr < tabend:
+		sys.exit('Unexpected image layout')
+
+	outimg = bytearray(img[: packaddr - base])
+	rawtotal = 0
+	packtotal = 0
+
+	for r in sorted(used, key = lambda r: r[1]):
+		(tabentry, loadaddr, dstaddr, dstend) = r
+		raw = bytes(img[loadaddr - base : loadaddr - base + dstend - dstaddr])
+		packed = lz4_compress(raw)
+		if lz4_decompress(packed, len(raw)) != raw:
+			sys.exit('LZ4 verification failed at region 0x%08X' % dstaddr)
+
+		while len(outimg) & 3:  # keep the images word aligned (bit 0 is the compression flag)
+			outimg.append(0xFF)
+		addr = base + len(outimg)
+
+		if len(packed) < len(raw):
+			outimg += packed
+			struct.pack_into('<I', outimg, tabentry - base, addr | 1)
+		else:
+			outimg += raw
+			struct.pack_into('<I', outimg, tabentry - base, addr)
+
+		rawtotal += len(raw)
+		packtotal += min(len(raw), len(packed))
+		print('  0x%08X: %8d -> %8d bytes' % (dstaddr, len(raw), min(len(raw), len(packed))))
+
+	# the empty regions get valid load address too
+	for r in regions:
+		if r[3] <= r[2]:
+			struct.pack_into('<I', outimg, r[0] - base, base + len(outimg))
+
+	with open(args.binfile, 'wb') as f:
+		f.write(outimg)
+
+	print('Image size: %d -> %d bytes, regions: %d -> %d bytes (%.1f %%)' % (len(img), len(outimg),
+	      rawtotal, packtotal, 100.0 * packtotal / max(rawtotal, 1)))
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+# -----------------------------------------------------------------------------
+# This file is a part of the NVCM project: https://github.com/nvitya/nvcm
+# Copyright (c) 2021 Viktor Nagy, nvitya
+#
+# This software is provided 'as-is', without any express or implied warranty.
+# In no event will the authors be held liable for any damages arising from
+# the use of this software. Permission is granted to anyone to use this
+# software for any purpose, including commercial applications, and to alter
+# it and redistribute it freely, subject to the following restrictions:
+#
+# 1. The origin of this software must not be misrepresented; you must not
+#    claim that you wrote the original software. If you use this software in
+#    a product, an acknowledgment in the product documentation would be
+#    appreciated but is not required.
+#
+# 2. Altered source versions must be plainly marked as such, and must not be
+#    misrepresented as being the original software.
+#
+# 3. This notice may not be removed or altered from any source distribution.
+# -----------------------------------------------------------------------------
+#  file:     pcprof.py
+#  brief:    Flat profile from the PC samples of the core/src/pcprof.cpp
+#  version:  1.00
+#  date:     2021-08-02
+#  authors:  nvitya
+#
+#  usage:
+#    SWO capture (raw ITM byte stream, e.g. from the OpenOCD "tpiu ... output <file>"):
+#      pcprof.py app.elf --swo swo.bin
+#
+#    RAM buffer dump (little endian 32 bit PC values), e.g. with gdb:
+#      dump binary memory ram.bin pcprof.buf pcprof.buf+pcprof.sample_count
+#      pcprof.py app.elf --ram ram.bin
+# -----------------------------------------------------------------------------
+
+import argparse
+import bisect
+import struct
+import subprocess
+import sys
+
+def load_symbols(elffile, nm):
+	# returns sorted list of (start, end, name) for the function symbols
+	out = subprocess.check_output([nm, '-S', '-C', '--defined-only', '-n', elffile], universal_newlines=True)
+	syms = []
+	for line in out.splitlines():
+		parts = line.split(None, 3)
+		if len(parts) < 4 or parts[2] not in 'tTwW':
+			continue
+		start = int(parts[0], 16) & ~1  # clear the thumb bit
+		size = int(parts[1], 16)
+		if size > 0:
+			syms.append((start, start + size, parts[3]))
+	syms.sort()
+	return syms
+
+def read_ram_samples(fname):
+	with open(fname, 'rb') as f:
+		data = f.read()
+	cnt = len(data) // 4
+	return list(struct.unpack('<%dI' % cnt, data[:cnt * 4]))
+
+def read_swo_samples(fname, port):
+	# decodes the ITM packet stream: DWT hardware PC samples and 32 bit stimulus port writes
+	with open(fname, 'rb') as f:
+		data = f.read()
+
+	samples = []
+	sleeps = 0
+	i = 0
+	n = len(data)
+	while i < n:
+		hdr = data[i]
+		i += 1
+		sizecode = hdr & 3
+		if sizecode == 0:
+			# synchronization, overflow, timestamp or extension: skip the continuation bytes
+			if (hdr & 0x80) and (hdr != 0x80):
+				while i < n and (data[i] & 0x80):
+					i += 1
+				i += 1
+			continue
+
+		plen = (0, 1, 2, 4)[sizecode]
+		if i + plen > n:
+			break
+
+		payload = data[i:i + plen]
+		i += plen
+
+		if hdr & 4:  # hardware source (DWT)
+			if (hdr >> 3) == 2:  # PC sample packet
+				if plen == 4:
+					samples.append(struct.unpack('<I', payload)[0])
+				else:
+					sleeps += 1
+		elif (hdr >> 3) == port and plen == 4:  # software stimulus port
+			samples.append(struct.unpack('<I', payload)[0])
+
+	return samples, sleeps
+
+def main():
+	ap = argparse.ArgumentParser(description='NVCM PC sampling profiler evaluation')
+	ap.add_argument('elf', help='the ELF file of the profiled firmware')
+	ap.add_argument('--swo', help='raw SWO (ITM) capture file')
+	ap.add_argument('--ram', help='RAM buffer dump file')
+	ap.add_argument('--port', type=int, default=1, help='ITM stimulus port (PCPROF_ITM_PORT), default = 1')
+	ap.add_argument('--nm', default='arm-none-eabi-nm', help='nm tool, default = arm-none-eabi-nm')
+	ap.add_argument('--top', type=int, default=40, help='number of the listed functions, default = 40')
+	args = ap.parse_args()
+
+	sleeps = 0
+	if args.swo:
+		samples, sleeps = read_swo_samples(args.swo, args.port)
+	elif args.ram:
+		samples = read_ram_samples(args.ram)
+	else:
+		ap.error('one of --swo or --ram is required')
+
+	if not samples:
+		print('No samples found.')
+		return 1
+
+	syms = load_symbols(args.elf, args.nm)
+	starts = [s[0] for s in syms]
+
+	counts = {}
+	unknown = 0
+	for pc in samples:
+		pc &= ~1
+		idx = bisect.bisect_right(starts, pc) - 1
+		if idx >= 0 and pc < syms[idx][1]:
+			name = syms[idx][2]
+			counts[name] = counts.get(name, 0) + 1
+		else:
+			unknown += 1
+
+	total = len(samples) + sleeps
+	print('samples: %d, sleep: %d, unknown: %d' % (len(samples), sleeps, unknown))
+	print('')
+	print('   count        %   function')
+	for name, cnt in sorted(counts.items(), key=lambda x: -x[1])[:args.top]:
+		print('%8d  %6.2f%%   %s' % (cnt, 100.0 * cnt / total, name))
+
+	return 0
+
+if __name__ == '__main__':
+	sys.exit(main())